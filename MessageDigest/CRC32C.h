@@ -0,0 +1,131 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include "MessageDigest.h"
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define MESSAGEDIGEST_HAS_CRC32_INSN 1
+#endif
+
+namespace MessageDigest
+{
+
+/*
+* CRC-32C (Castagnoli, reflected polynomial 0x82f63b78) as used by iSCSI, ext4 and cloud object stores
+* Uses the SSE4.2 crc32 instruction when the CPU has it, otherwise a slicing-by-8 table
+* finalize() returns the 4 bytes big-endian, so toString() prints the usual hex value
+*/
+
+namespace detail
+{
+
+struct CRC32CTable {
+    uint32_t t[8][256];
+    CRC32CTable() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int k = 0; k < 8; ++k)
+                crc = crc & 1 ? (crc >> 1) ^ 0x82f63b78U : crc >> 1;
+            t[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int k = 1; k < 8; ++k)
+                t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xff];
+        }
+    }
+};
+
+inline uint32_t crc32cScalar(uint32_t crc, const uint8_t* data, size_t len) {
+    static const CRC32CTable table;
+    const uint32_t(*t)[256] = table.t;
+    /* 8 bytes per step with 8 independent lookups */
+    for (; len >= 8; len -= 8, data += 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, data, 4);
+        memcpy(&hi, data + 4, 4);
+        lo ^= crc;
+        crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+            t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+    }
+    for (; len > 0; --len, ++data)
+        crc = (crc >> 8) ^ t[0][(crc ^ *data) & 0xff];
+    return crc;
+}
+
+#ifdef MESSAGEDIGEST_HAS_CRC32_INSN
+__attribute__((target("sse4.2"))) inline uint32_t crc32cSSE42(uint32_t crc, const uint8_t* data, size_t len) {
+#if defined(__x86_64__)
+    uint64_t crc64 = crc;
+    for (; len >= 8; len -= 8, data += 8) {
+        uint64_t v;
+        memcpy(&v, data, 8);
+        crc64 = _mm_crc32_u64(crc64, v);
+    }
+    crc = (uint32_t)crc64;
+#endif
+    for (; len >= 4; len -= 4, data += 4) {
+        uint32_t v;
+        memcpy(&v, data, 4);
+        crc = _mm_crc32_u32(crc, v);
+    }
+    for (; len > 0; --len, ++data)
+        crc = _mm_crc32_u8(crc, *data);
+    return crc;
+}
+#endif
+
+}
+
+class CRC32C : public Digest {
+public:
+    using Digest::update;
+
+    CRC32C() : kernel(pick()) {
+        reset();
+    }
+
+    void reset() override {
+        crc = 0xffffffffU;
+    }
+
+    CRC32C &update(const void* input, size_t len) override {
+        crc = kernel(crc, (const uint8_t*)input, len);
+        return *this;
+    }
+
+    vector<uint8_t> finalize() override {
+        uint32_t v = value();
+        return vector<uint8_t>{ (uint8_t)(v >> 24), (uint8_t)(v >> 16), (uint8_t)(v >> 8), (uint8_t)v };
+    }
+
+    size_t size() const override {
+        return 4;
+    }
+
+    /* the checksum as an integer, e.g. 0xe3069283 for "123456789" */
+    uint32_t value() const {
+        return crc ^ 0xffffffffU;
+    }
+
+    /* true if the crc32 instruction is in use */
+    static bool accelerated() {
+        return pick() != detail::crc32cScalar;
+    }
+
+private:
+    typedef uint32_t (*Kernel)(uint32_t crc, const uint8_t* data, size_t len);
+
+    static Kernel pick() {
+#ifdef MESSAGEDIGEST_HAS_CRC32_INSN
+        static const Kernel kernel = __builtin_cpu_supports("sse4.2") ? detail::crc32cSSE42 : detail::crc32cScalar;
+        return kernel;
+#else
+        return detail::crc32cScalar;
+#endif
+    }
+
+    Kernel kernel;
+    uint32_t crc;
+};
+
+}
@@ -0,0 +1,218 @@
+#pragma once
+#include <functional>
+#include "MessageDigest.h"
+#include "MD5Batch.h"
+
+namespace MessageDigest
+{
+
+/*
+* Content-defined chunking (FastCDC: Gear rolling hash with normalized chunking) plus the MD5 of every chunk
+* Boundaries depend only on nearby content, so an insertion changes the chunks around it and not the rest.
+* Chunks that lie inside one update() are hashed by md5Batch 64 at a time, a chunk spanning
+* update() calls is hashed incrementally, both while the bytes are still in cache.
+*
+* @example: ContentChunker chunker([&](const ContentChunker::Chunk &c) { store(c.digest, c.offset, c.length); });
+*           chunker.update(data, len); ...; chunker.finish();
+*/
+class ContentChunker {
+public:
+    struct Chunk {
+        /* position in the whole stream */
+        uint64_t offset;
+        size_t length;
+        MD5::Result digest;
+    };
+    typedef std::function<void(const Chunk&)> Sink;
+
+    /*
+    * @param {sink} receives the chunks in stream order.
+    *
+    * @param {minSize, avgSize, maxSize} chunk sizes, avgSize is rounded down to a power of two,
+    *        they are clamped so that 0 < minSize <= avgSize <= maxSize.
+    */
+    explicit ContentChunker(Sink sink, size_t minSize = 2048, size_t avgSize = 8192, size_t maxSize = 65536)
+        : sink(std::move(sink)), minSize(minSize), avgSize(avgSize), maxSize(maxSize) {
+        /* clamped rather than asserted, maxSize < minSize would underflow the scan limits in release builds */
+        if (this->minSize == 0)
+            this->minSize = 1;
+        if (this->avgSize < this->minSize)
+            this->avgSize = this->minSize;
+        if (this->maxSize < this->avgSize)
+            this->maxSize = this->avgSize;
+        int bits = 0;
+        while (((size_t)2 << bits) <= this->avgSize)
+            ++bits;
+        /* normalization level 2: harder to cut before avgSize, easier after it */
+        maskS = highBits(bits + 2);
+        maskL = highBits(bits > 2 ? bits - 2 : 1);
+        reset();
+    }
+
+    void reset() {
+        offset = 0;
+        chunkLen = 0;
+        fp = 0;
+        md5.reset();
+    }
+
+    /*
+    * @Append the next bytes of the stream, complete chunks go to the sink before returning.
+    */
+    ContentChunker &update(const void* input, size_t len) {
+        const uint8_t* data = (const uint8_t*)input;
+        size_t pos = 0;
+        /* 1.finish the chunk carried over from the previous call */
+        if (chunkLen > 0) {
+            size_t carried = chunkLen;
+            size_t cut = scan(data, len);
+            md5.update(data, cut);
+            pos = cut;
+            if (chunkLen > 0)
+                return *this;
+            emit(md5.digestArray(), carried + cut);
+        }
+        /* 2.chunks completely inside this input, hashed in batches of BatchSize while they are still in cache */
+        while (pos < len) {
+            size_t cut = scan(data + pos, len - pos);
+            if (chunkLen > 0) {
+                md5.reset();
+                md5.update(data + pos, cut);
+                break;
+            }
+            messages.push_back(data + pos);
+            lens.push_back(cut);
+            pos += cut;
+            if (messages.size() == BatchSize)
+                flushBatch();
+        }
+        flushBatch();
+        /* 3.the tail stays open in md5 and chunkLen */
+        return *this;
+    }
+
+    /*
+    * @End of stream, emits the last chunk if any and starts a new stream.
+    */
+    void finish() {
+        if (chunkLen > 0) {
+            size_t len = chunkLen;
+            chunkLen = 0;
+            emit(md5.digestArray(), len);
+        }
+        reset();
+    }
+
+    /*
+    * @Chunk a whole buffer.
+    */
+    static vector<Chunk> split(const void* input, size_t len, size_t minSize = 2048, size_t avgSize = 8192, size_t maxSize = 65536) {
+        vector<Chunk> chunks;
+        ContentChunker chunker([&](const Chunk &c) { chunks.push_back(c); }, minSize, avgSize, maxSize);
+        chunker.update(input, len);
+        chunker.finish();
+        return chunks;
+    }
+
+private:
+    static uint64_t highBits(int n) {
+        return n >= 64 ? ~0ULL : ~0ULL << (64 - n);
+    }
+
+    /* random 64-bit values per byte, fixed so boundaries are stable across runs and builds */
+    struct GearTable {
+        uint64_t g[256];
+        GearTable() {
+            uint64_t x = 0x6a09e667f3bcc908ULL;
+            for (int i = 0; i < 256; ++i) {
+                /* splitmix64 */
+                uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+                g[i] = z ^ (z >> 31);
+            }
+        }
+    };
+
+    /*
+    * Advance the open chunk over p[0,n).
+    * @return bytes consumed, chunkLen is 0 afterwards if the chunk ended there.
+    */
+    size_t scan(const uint8_t* p, size_t n) {
+        static const GearTable table;
+        const uint64_t* g = table.g;
+        size_t len = chunkLen;
+        size_t i = 0;
+        uint64_t h = fp;
+        /* the first minSize bytes can never end a chunk, skip them unhashed */
+        if (len < minSize) {
+            size_t skip = minSize - len < n ? minSize - len : n;
+            i += skip;
+            len += skip;
+        }
+        size_t end = len < avgSize ? i + (avgSize - len) : i;
+        if (end > n)
+            end = n;
+        for (; i < end; ++i) {
+            h = (h << 1) + g[p[i]];
+            if (!(h & maskS))
+                return cut(i + 1);
+        }
+        len = chunkLen + i;
+        end = i + (maxSize - len);
+        if (end > n)
+            end = n;
+        for (; i < end; ++i) {
+            h = (h << 1) + g[p[i]];
+            if (!(h & maskL))
+                return cut(i + 1);
+        }
+        if (chunkLen + i == maxSize)
+            return cut(i);
+        chunkLen += i;
+        fp = h;
+        return n;
+    }
+
+    size_t cut(size_t consumed) {
+        chunkLen = 0;
+        fp = 0;
+        return consumed;
+    }
+
+    void flushBatch() {
+        digests.resize(messages.size() * 16);
+        md5Batch(messages.data(), lens.data(), messages.size(), digests.data());
+        for (size_t i = 0; i < messages.size(); ++i) {
+            MD5::Result digest;
+            memcpy(digest.data(), &digests[i * 16], 16);
+            emit(digest, lens[i]);
+        }
+        messages.clear();
+        lens.clear();
+    }
+
+    void emit(const MD5::Result& digest, size_t len) {
+        Chunk chunk = { offset, len, digest };
+        offset += len;
+        sink(chunk);
+    }
+
+    Sink sink;
+    size_t minSize, avgSize, maxSize;
+    uint64_t maskS, maskL;
+
+    /* the open chunk */
+    uint64_t offset;
+    size_t chunkLen;
+    uint64_t fp;
+    MD5 md5;
+
+    /* reused by the batch path */
+    static const size_t BatchSize = 64;
+    vector<const void*> messages;
+    vector<size_t> lens;
+    vector<uint8_t> digests;
+};
+
+}
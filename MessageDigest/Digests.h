@@ -0,0 +1,35 @@
+#pragma once
+#include <memory>
+#include "MessageDigest.h"
+#include "SHA.h"
+#include "CRC32C.h"
+#include "XXHash64.h"
+
+namespace MessageDigest
+{
+
+enum class DigestType {
+    MD5,
+    SHA1,
+    SHA256,
+    CRC32C,
+    XXH64
+};
+
+/*
+* @Create a digest by type, callers only see the Digest interface
+*
+* @example: makeDigest(DigestType::SHA256)->update("abc").toString()
+*/
+inline std::unique_ptr<Digest> makeDigest(DigestType type) {
+    switch (type) {
+    case DigestType::MD5: return std::unique_ptr<Digest>(new MD5());
+    case DigestType::SHA1: return std::unique_ptr<Digest>(new SHA1());
+    case DigestType::SHA256: return std::unique_ptr<Digest>(new SHA256());
+    case DigestType::CRC32C: return std::unique_ptr<Digest>(new CRC32C());
+    case DigestType::XXH64: return std::unique_ptr<Digest>(new XXH64());
+    }
+    return nullptr;
+}
+
+}
@@ -0,0 +1,426 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <cerrno>
+#include <cstdlib>
+#include "Digests.h"
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#define MESSAGEDIGEST_HAS_IO_URING 1
+#endif
+#endif
+#endif
+
+namespace MessageDigest
+{
+
+/*
+* Digests many files with deep I/O queues
+* Each worker thread owns an io_uring with depth slots, a slot streams one file through one buffer:
+* while a completed buffer is hashed the reads of the other slots stay in flight.
+* Without io_uring (old kernel, seccomp, non-Linux) the workers fall back to blocking pread.
+* All buffers come from one aligned block allocated up front and reused for every file.
+*/
+
+struct FileDigest {
+    string path;
+    /* false if the file could not be opened or read */
+    bool ok;
+    vector<uint8_t> digest;
+
+    string toString() const {
+        return Digest::toHex(digest);
+    }
+};
+
+namespace detail
+{
+
+/* count buffers of size bytes from one block, aligned for O_DIRECT */
+class AlignedBufferPool {
+public:
+    AlignedBufferPool(size_t size, size_t count, size_t alignment = 4096)
+        : size((size + alignment - 1) / alignment * alignment),
+        raw(new uint8_t[this->size * count + alignment]) {
+        uintptr_t p = (uintptr_t)raw.get();
+        base = (uint8_t*)((p + alignment - 1) / alignment * alignment);
+    }
+
+    uint8_t* get(size_t i) const {
+        return base + i * size;
+    }
+
+    size_t bufferSize() const {
+        return size;
+    }
+
+private:
+    size_t size;
+    std::unique_ptr<uint8_t[]> raw;
+    uint8_t* base;
+};
+
+#ifdef MESSAGEDIGEST_HAS_IO_URING
+/* the minimum of the io_uring ABI: one ring, fixed buffers, READ_FIXED submissions */
+class IoUring {
+public:
+    IoUring(unsigned entries, const AlignedBufferPool& pool, unsigned buffers) {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+        if (fd < 0)
+            return;
+        sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single)
+            sqSize = cqSize = sqSize > cqSize ? sqSize : cqSize;
+        sqRing = mmap(nullptr, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        cqRing = single ? sqRing : mmap(nullptr, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = (io_uring_sqe*)mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqes == (io_uring_sqe*)MAP_FAILED) {
+            release();
+            return;
+        }
+        uint8_t* sq = (uint8_t*)sqRing;
+        uint8_t* cq = (uint8_t*)cqRing;
+        sqTail = (unsigned*)(sq + params.sq_off.tail);
+        sqMask = *(unsigned*)(sq + params.sq_off.ring_mask);
+        sqArray = (unsigned*)(sq + params.sq_off.array);
+        cqHead = (unsigned*)(cq + params.cq_off.head);
+        cqTail = (unsigned*)(cq + params.cq_off.tail);
+        cqMask = *(unsigned*)(cq + params.cq_off.ring_mask);
+        cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+        /* registered buffers are pinned once instead of on every read */
+        vector<iovec> iov(buffers);
+        for (unsigned i = 0; i < buffers; ++i) {
+            iov[i].iov_base = pool.get(i);
+            iov[i].iov_len = pool.bufferSize();
+        }
+        if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, iov.data(), buffers) < 0)
+            release();
+    }
+
+    ~IoUring() {
+        release();
+    }
+
+    IoUring(const IoUring&) = delete;
+    IoUring &operator=(const IoUring&) = delete;
+
+    bool valid() const {
+        return fd >= 0;
+    }
+
+    /* queue a read of registered buffer index into buf, submitted by the next wait() */
+    void read(int file, uint8_t* buf, unsigned len, uint64_t offset, unsigned index, uint64_t userData) {
+        unsigned tail = *sqTail;
+        unsigned i = tail & sqMask;
+        io_uring_sqe* sqe = &sqes[i];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->fd = file;
+        sqe->addr = (uint64_t)(uintptr_t)buf;
+        sqe->len = len;
+        sqe->off = offset;
+        sqe->buf_index = (uint16_t)index;
+        sqe->user_data = userData;
+        sqArray[i] = i;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        ++pending;
+    }
+
+    /* submit queued reads and block until at least one completion */
+    bool wait() {
+        for (;;) {
+            int ret = (int)syscall(__NR_io_uring_enter, fd, pending, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (ret >= 0) {
+                pending -= (unsigned)ret < pending ? (unsigned)ret : pending;
+                return true;
+            }
+            if (errno != EINTR)
+                return false;
+        }
+    }
+
+    /* call f(userData, res) for every completion available */
+    template<typename OnComplete>
+    void reap(OnComplete f) {
+        unsigned head = *cqHead;
+        unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const io_uring_cqe &cqe = cqes[head & cqMask];
+            uint64_t userData = cqe.user_data;
+            int res = cqe.res;
+            __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+            f(userData, res);
+        }
+    }
+
+private:
+    void release() {
+        if (sqes && sqes != (io_uring_sqe*)MAP_FAILED)
+            munmap(sqes, sqesSize);
+        if (cqRing && cqRing != MAP_FAILED && cqRing != sqRing)
+            munmap(cqRing, cqSize);
+        if (sqRing && sqRing != MAP_FAILED)
+            munmap(sqRing, sqSize);
+        if (fd >= 0)
+            close(fd);
+        sqes = nullptr;
+        sqRing = cqRing = nullptr;
+        fd = -1;
+    }
+
+    int fd = -1;
+    void* sqRing = nullptr;
+    void* cqRing = nullptr;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqSize = 0, cqSize = 0, sqesSize = 0;
+    unsigned* sqTail = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned sqMask = 0;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe* cqes = nullptr;
+    unsigned pending = 0;
+};
+#endif
+
+}
+
+class FileDigestPipeline {
+public:
+    /*
+    * @param {type} digest computed for every file.
+    *
+    * @param {bufferSize} bytes per read.
+    *
+    * @param {depth} files in flight per worker thread.
+    *
+    * @param {threads} hashing threads, 0 uses every hardware thread.
+    *
+    * @param {directIO} open with O_DIRECT to bypass the page cache where the file system allows it.
+    */
+    explicit FileDigestPipeline(DigestType type = DigestType::MD5, size_t bufferSize = (size_t)256 << 10,
+        unsigned depth = 16, unsigned threads = 0, bool directIO = false)
+        : type(type), bufferSize(bufferSize ? bufferSize : 4096), depth(depth ? depth : 1),
+        threads(threads ? threads : std::thread::hardware_concurrency()), directIO(directIO) {
+        if (this->threads == 0)
+            this->threads = 1;
+        /* whole pages for O_DIRECT, and a single 32-bit read length per submission */
+        if (this->bufferSize > ((size_t)1 << 30))
+            this->bufferSize = (size_t)1 << 30;
+        this->bufferSize = (this->bufferSize + 4095) / 4096 * 4096;
+    }
+
+    /*
+    * @Digest every file, results are in the order of paths.
+    */
+    vector<FileDigest> hashFiles(const vector<string>& paths) {
+        vector<FileDigest> results(paths.size());
+        std::atomic<size_t> next(0);
+        std::atomic<bool> ring(false);
+        auto worker = [&]() {
+            if (run(paths, results, next))
+                ring = true;
+        };
+        size_t workers = threads < paths.size() ? threads : paths.size();
+        vector<std::thread> pool;
+        for (size_t t = 1; t < workers; ++t)
+            pool.emplace_back(worker);
+        if (workers > 0)
+            worker();
+        for (std::thread &t : pool)
+            t.join();
+        usedIoUring = ring;
+        return results;
+    }
+
+    /* true if the last hashFiles() used io_uring in at least one worker */
+    bool usingIoUring() const {
+        return usedIoUring;
+    }
+
+private:
+    /* one file streaming through one buffer */
+    struct Slot {
+        int fd = -1;
+        size_t file = 0;
+        uint64_t offset = 0;
+        std::unique_ptr<Digest> digest;
+    };
+
+    int openFile(const string& path) const {
+#ifdef MESSAGEDIGEST_HAS_MMAP
+        int flags = O_RDONLY;
+#ifdef O_DIRECT
+        if (directIO) {
+            int fd = open(path.c_str(), flags | O_DIRECT);
+            if (fd >= 0)
+                return fd;
+        }
+#endif
+        int fd = open(path.c_str(), flags);
+#ifdef POSIX_FADV_SEQUENTIAL
+        if (fd >= 0)
+            posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        return fd;
+#else
+        (void)path;
+        return -1;
+#endif
+    }
+
+    /* a worker, returns true if it used io_uring */
+    bool run(const vector<string>& paths, vector<FileDigest>& results, std::atomic<size_t>& next) const {
+        detail::AlignedBufferPool pool(bufferSize, depth);
+#ifdef MESSAGEDIGEST_HAS_IO_URING
+        detail::IoUring ring(depth, pool, depth);
+        if (ring.valid()) {
+            runRing(ring, pool, paths, results, next);
+            return true;
+        }
+#endif
+        runBlocking(pool.get(0), paths, results, next);
+        return false;
+    }
+
+#ifdef MESSAGEDIGEST_HAS_IO_URING
+    void runRing(detail::IoUring& ring, const detail::AlignedBufferPool& pool,
+        const vector<string>& paths, vector<FileDigest>& results, std::atomic<size_t>& next) const {
+        vector<Slot> slots(depth);
+        unsigned inFlight = 0;
+        unsigned len = (unsigned)pool.bufferSize();
+        /* 1.give the slot the next file that opens, false when none is left */
+        auto start = [&](unsigned s) {
+            Slot &slot = slots[s];
+            for (size_t i = next++; i < paths.size(); i = next++) {
+                results[i].path = paths[i];
+                slot.fd = openFile(paths[i]);
+                if (slot.fd < 0) {
+                    results[i].ok = false;
+                    continue;
+                }
+                slot.file = i;
+                slot.offset = 0;
+                if (!slot.digest)
+                    slot.digest = makeDigest(type);
+                slot.digest->reset();
+                ring.read(slot.fd, pool.get(s), len, 0, s, s);
+                ++inFlight;
+                return;
+            }
+        };
+        auto finish = [&](Slot &slot, bool ok) {
+            close(slot.fd);
+            slot.fd = -1;
+            results[slot.file].ok = ok;
+            if (ok)
+                results[slot.file].digest = slot.digest->finalize();
+        };
+        for (unsigned s = 0; s < depth; ++s)
+            start(s);
+        /* 2.hash each completed buffer, then reuse it for the next read of the same slot */
+        while (inFlight > 0) {
+            if (!ring.wait()) {
+                /* the ring broke, finish the queued files synchronously, the pool may still be targeted */
+                detail::AlignedBufferPool spare(bufferSize, 1);
+                for (Slot &slot : slots) {
+                    if (slot.fd >= 0)
+                        finish(slot, drain(slot, spare.get(0)));
+                }
+                runBlocking(spare.get(0), paths, results, next);
+                return;
+            }
+            ring.reap([&](uint64_t s, int res) {
+                --inFlight;
+                Slot &slot = slots[s];
+                if (res == -EINTR || res == -EAGAIN) {
+                    ring.read(slot.fd, pool.get(s), len, slot.offset, (unsigned)s, s);
+                    ++inFlight;
+                    return;
+                }
+                if (res <= 0) {
+                    finish(slot, res == 0);
+                    start((unsigned)s);
+                    return;
+                }
+                slot.digest->update(pool.get(s), (size_t)res);
+                slot.offset += (uint64_t)res;
+                ring.read(slot.fd, pool.get(s), len, slot.offset, (unsigned)s, s);
+                ++inFlight;
+            });
+        }
+    }
+#endif
+
+    /* read the rest of a slot's file with pread, true on end of file */
+    bool drain(Slot& slot, uint8_t* buf) const {
+#ifdef MESSAGEDIGEST_HAS_MMAP
+        for (;;) {
+            ssize_t n = pread(slot.fd, buf, bufferSize, (off_t)slot.offset);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return n == 0;
+            slot.digest->update(buf, (size_t)n);
+            slot.offset += (uint64_t)n;
+        }
+#else
+        (void)slot;
+        (void)buf;
+        return false;
+#endif
+    }
+
+    void runBlocking(uint8_t* buf, const vector<string>& paths, vector<FileDigest>& results, std::atomic<size_t>& next) const {
+        std::unique_ptr<Digest> digest = makeDigest(type);
+        for (size_t i = next++; i < paths.size(); i = next++) {
+            results[i].path = paths[i];
+            digest->reset();
+#ifdef MESSAGEDIGEST_HAS_MMAP
+            Slot slot;
+            slot.fd = openFile(paths[i]);
+            if (slot.fd < 0) {
+                results[i].ok = false;
+                continue;
+            }
+            slot.digest = std::move(digest);
+            bool ok = drain(slot, buf);
+            close(slot.fd);
+            digest = std::move(slot.digest);
+#else
+            FILE* file = fopen(paths[i].c_str(), "rb");
+            if (!file) {
+                results[i].ok = false;
+                continue;
+            }
+            size_t n;
+            while ((n = fread(buf, 1, bufferSize, file)) > 0)
+                digest->update(buf, n);
+            bool ok = !ferror(file);
+            fclose(file);
+#endif
+            results[i].ok = ok;
+            if (ok)
+                results[i].digest = digest->finalize();
+        }
+    }
+
+    DigestType type;
+    size_t bufferSize;
+    unsigned depth;
+    unsigned threads;
+    bool directIO;
+    bool usedIoUring = false;
+};
+
+}
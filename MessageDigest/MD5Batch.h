@@ -0,0 +1,275 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include "MessageDigest.h"
+
+namespace MessageDigest
+{
+
+/*
+* Multi-buffer MD5: N independent messages are hashed side by side, one message per SIMD lane,
+* 4 lanes with SSE2, 8 with AVX2 and 16 with AVX-512, the kernel is picked at run time.
+* A lane that finishes its message takes the next one, so mixed lengths keep every lane busy.
+* The result is bit-identical to MD5, other compilers and CPUs fall back to it.
+*/
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MESSAGEDIGEST_HAS_MD5_BATCH_SIMD 1
+
+namespace detail
+{
+
+typedef uint32_t MD5x4 __attribute__((vector_size(16)));
+typedef uint32_t MD5x8 __attribute__((vector_size(32)));
+typedef uint32_t MD5x16 __attribute__((vector_size(64)));
+
+/* same boolean forms as F/G/H/I, with one operation less for F and G */
+#define MD5_BATCH_STEP(f, a, b, c, d, x, s, ac) \
+    a += f + x + ac;                            \
+    a = ((a << s) | (a >> (32 - s))) + b;
+#define MD5_BATCH_F(b, c, d) (((c ^ d) & b) ^ d)
+#define MD5_BATCH_G(b, c, d) (((b ^ c) & d) ^ c)
+#define MD5_BATCH_H(b, c, d) (b ^ c ^ d)
+#define MD5_BATCH_I(b, c, d) (c ^ (b | ~d))
+
+/* one 64-byte block for every lane, x[i] holds word i of all lanes */
+template<typename V>
+__attribute__((always_inline)) inline void md5BatchTransform(V* st, const V* x) {
+    V a = st[0], b = st[1], c = st[2], d = st[3];
+
+    /* Round 1 */
+    MD5_BATCH_STEP(MD5_BATCH_F(b, c, d), a, b, c, d, x[0], s11, 0xd76aa478U)
+    MD5_BATCH_STEP(MD5_BATCH_F(a, b, c), d, a, b, c, x[1], s12, 0xe8c7b756U)
+    MD5_BATCH_STEP(MD5_BATCH_F(d, a, b), c, d, a, b, x[2], s13, 0x242070dbU)
+    MD5_BATCH_STEP(MD5_BATCH_F(c, d, a), b, c, d, a, x[3], s14, 0xc1bdceeeU)
+    MD5_BATCH_STEP(MD5_BATCH_F(b, c, d), a, b, c, d, x[4], s11, 0xf57c0fafU)
+    MD5_BATCH_STEP(MD5_BATCH_F(a, b, c), d, a, b, c, x[5], s12, 0x4787c62aU)
+    MD5_BATCH_STEP(MD5_BATCH_F(d, a, b), c, d, a, b, x[6], s13, 0xa8304613U)
+    MD5_BATCH_STEP(MD5_BATCH_F(c, d, a), b, c, d, a, x[7], s14, 0xfd469501U)
+    MD5_BATCH_STEP(MD5_BATCH_F(b, c, d), a, b, c, d, x[8], s11, 0x698098d8U)
+    MD5_BATCH_STEP(MD5_BATCH_F(a, b, c), d, a, b, c, x[9], s12, 0x8b44f7afU)
+    MD5_BATCH_STEP(MD5_BATCH_F(d, a, b), c, d, a, b, x[10], s13, 0xffff5bb1U)
+    MD5_BATCH_STEP(MD5_BATCH_F(c, d, a), b, c, d, a, x[11], s14, 0x895cd7beU)
+    MD5_BATCH_STEP(MD5_BATCH_F(b, c, d), a, b, c, d, x[12], s11, 0x6b901122U)
+    MD5_BATCH_STEP(MD5_BATCH_F(a, b, c), d, a, b, c, x[13], s12, 0xfd987193U)
+    MD5_BATCH_STEP(MD5_BATCH_F(d, a, b), c, d, a, b, x[14], s13, 0xa679438eU)
+    MD5_BATCH_STEP(MD5_BATCH_F(c, d, a), b, c, d, a, x[15], s14, 0x49b40821U)
+
+    /* Round 2 */
+    MD5_BATCH_STEP(MD5_BATCH_G(b, c, d), a, b, c, d, x[1], s21, 0xf61e2562U)
+    MD5_BATCH_STEP(MD5_BATCH_G(a, b, c), d, a, b, c, x[6], s22, 0xc040b340U)
+    MD5_BATCH_STEP(MD5_BATCH_G(d, a, b), c, d, a, b, x[11], s23, 0x265e5a51U)
+    MD5_BATCH_STEP(MD5_BATCH_G(c, d, a), b, c, d, a, x[0], s24, 0xe9b6c7aaU)
+    MD5_BATCH_STEP(MD5_BATCH_G(b, c, d), a, b, c, d, x[5], s21, 0xd62f105dU)
+    MD5_BATCH_STEP(MD5_BATCH_G(a, b, c), d, a, b, c, x[10], s22, 0x02441453U)
+    MD5_BATCH_STEP(MD5_BATCH_G(d, a, b), c, d, a, b, x[15], s23, 0xd8a1e681U)
+    MD5_BATCH_STEP(MD5_BATCH_G(c, d, a), b, c, d, a, x[4], s24, 0xe7d3fbc8U)
+    MD5_BATCH_STEP(MD5_BATCH_G(b, c, d), a, b, c, d, x[9], s21, 0x21e1cde6U)
+    MD5_BATCH_STEP(MD5_BATCH_G(a, b, c), d, a, b, c, x[14], s22, 0xc33707d6U)
+    MD5_BATCH_STEP(MD5_BATCH_G(d, a, b), c, d, a, b, x[3], s23, 0xf4d50d87U)
+    MD5_BATCH_STEP(MD5_BATCH_G(c, d, a), b, c, d, a, x[8], s24, 0x455a14edU)
+    MD5_BATCH_STEP(MD5_BATCH_G(b, c, d), a, b, c, d, x[13], s21, 0xa9e3e905U)
+    MD5_BATCH_STEP(MD5_BATCH_G(a, b, c), d, a, b, c, x[2], s22, 0xfcefa3f8U)
+    MD5_BATCH_STEP(MD5_BATCH_G(d, a, b), c, d, a, b, x[7], s23, 0x676f02d9U)
+    MD5_BATCH_STEP(MD5_BATCH_G(c, d, a), b, c, d, a, x[12], s24, 0x8d2a4c8aU)
+
+    /* Round 3 */
+    MD5_BATCH_STEP(MD5_BATCH_H(b, c, d), a, b, c, d, x[5], s31, 0xfffa3942U)
+    MD5_BATCH_STEP(MD5_BATCH_H(a, b, c), d, a, b, c, x[8], s32, 0x8771f681U)
+    MD5_BATCH_STEP(MD5_BATCH_H(d, a, b), c, d, a, b, x[11], s33, 0x6d9d6122U)
+    MD5_BATCH_STEP(MD5_BATCH_H(c, d, a), b, c, d, a, x[14], s34, 0xfde5380cU)
+    MD5_BATCH_STEP(MD5_BATCH_H(b, c, d), a, b, c, d, x[1], s31, 0xa4beea44U)
+    MD5_BATCH_STEP(MD5_BATCH_H(a, b, c), d, a, b, c, x[4], s32, 0x4bdecfa9U)
+    MD5_BATCH_STEP(MD5_BATCH_H(d, a, b), c, d, a, b, x[7], s33, 0xf6bb4b60U)
+    MD5_BATCH_STEP(MD5_BATCH_H(c, d, a), b, c, d, a, x[10], s34, 0xbebfbc70U)
+    MD5_BATCH_STEP(MD5_BATCH_H(b, c, d), a, b, c, d, x[13], s31, 0x289b7ec6U)
+    MD5_BATCH_STEP(MD5_BATCH_H(a, b, c), d, a, b, c, x[0], s32, 0xeaa127faU)
+    MD5_BATCH_STEP(MD5_BATCH_H(d, a, b), c, d, a, b, x[3], s33, 0xd4ef3085U)
+    MD5_BATCH_STEP(MD5_BATCH_H(c, d, a), b, c, d, a, x[6], s34, 0x04881d05U)
+    MD5_BATCH_STEP(MD5_BATCH_H(b, c, d), a, b, c, d, x[9], s31, 0xd9d4d039U)
+    MD5_BATCH_STEP(MD5_BATCH_H(a, b, c), d, a, b, c, x[12], s32, 0xe6db99e5U)
+    MD5_BATCH_STEP(MD5_BATCH_H(d, a, b), c, d, a, b, x[15], s33, 0x1fa27cf8U)
+    MD5_BATCH_STEP(MD5_BATCH_H(c, d, a), b, c, d, a, x[2], s34, 0xc4ac5665U)
+
+    /* Round 4 */
+    MD5_BATCH_STEP(MD5_BATCH_I(b, c, d), a, b, c, d, x[0], s41, 0xf4292244U)
+    MD5_BATCH_STEP(MD5_BATCH_I(a, b, c), d, a, b, c, x[7], s42, 0x432aff97U)
+    MD5_BATCH_STEP(MD5_BATCH_I(d, a, b), c, d, a, b, x[14], s43, 0xab9423a7U)
+    MD5_BATCH_STEP(MD5_BATCH_I(c, d, a), b, c, d, a, x[5], s44, 0xfc93a039U)
+    MD5_BATCH_STEP(MD5_BATCH_I(b, c, d), a, b, c, d, x[12], s41, 0x655b59c3U)
+    MD5_BATCH_STEP(MD5_BATCH_I(a, b, c), d, a, b, c, x[3], s42, 0x8f0ccc92U)
+    MD5_BATCH_STEP(MD5_BATCH_I(d, a, b), c, d, a, b, x[10], s43, 0xffeff47dU)
+    MD5_BATCH_STEP(MD5_BATCH_I(c, d, a), b, c, d, a, x[1], s44, 0x85845dd1U)
+    MD5_BATCH_STEP(MD5_BATCH_I(b, c, d), a, b, c, d, x[8], s41, 0x6fa87e4fU)
+    MD5_BATCH_STEP(MD5_BATCH_I(a, b, c), d, a, b, c, x[15], s42, 0xfe2ce6e0U)
+    MD5_BATCH_STEP(MD5_BATCH_I(d, a, b), c, d, a, b, x[6], s43, 0xa3014314U)
+    MD5_BATCH_STEP(MD5_BATCH_I(c, d, a), b, c, d, a, x[13], s44, 0x4e0811a1U)
+    MD5_BATCH_STEP(MD5_BATCH_I(b, c, d), a, b, c, d, x[4], s41, 0xf7537e82U)
+    MD5_BATCH_STEP(MD5_BATCH_I(a, b, c), d, a, b, c, x[11], s42, 0xbd3af235U)
+    MD5_BATCH_STEP(MD5_BATCH_I(d, a, b), c, d, a, b, x[2], s43, 0x2ad7d2bbU)
+    MD5_BATCH_STEP(MD5_BATCH_I(c, d, a), b, c, d, a, x[9], s44, 0xeb86d391U)
+
+    st[0] += a;
+    st[1] += b;
+    st[2] += c;
+    st[3] += d;
+}
+
+#undef MD5_BATCH_STEP
+#undef MD5_BATCH_F
+#undef MD5_BATCH_G
+#undef MD5_BATCH_H
+#undef MD5_BATCH_I
+
+/* per lane cursor over the full blocks of a message, then over its padded tail */
+struct MD5BatchLane {
+    const uint8_t* data;
+    size_t blocks;
+    size_t msg;
+    int tailBlocks, tailPos;
+    bool active;
+    uint8_t tail[128];
+};
+
+template<typename V>
+__attribute__((always_inline)) inline void md5BatchKernel(const void* const* messages, const size_t* lens, size_t n, uint8_t* digests) {
+    const int L = sizeof(V) / sizeof(uint32_t);
+    V st[4], x[16];
+    uint32_t* stLane = reinterpret_cast<uint32_t*>(st);
+    uint32_t* xLane = reinterpret_cast<uint32_t*>(x);
+    static const uint8_t idle[64] = { 0 };
+    MD5BatchLane lane[L];
+    size_t next = 0;
+
+    /* 1.load the next message into lane l and reset its state */
+    auto start = [&](int l) {
+        MD5BatchLane& ln = lane[l];
+        if (next == n) {
+            ln.active = false;
+            return;
+        }
+        ln.active = true;
+        ln.msg = next++;
+        ln.data = static_cast<const uint8_t*>(messages[ln.msg]);
+        size_t len = lens[ln.msg];
+        ln.blocks = len / 64;
+        size_t rem = len % 64;
+        ln.tailBlocks = rem < 56 ? 1 : 2;
+        ln.tailPos = 0;
+        memset(ln.tail, 0, sizeof(ln.tail));
+        /* empty messages may come with a null pointer */
+        if (rem)
+            memcpy(ln.tail, ln.data + ln.blocks * 64, rem);
+        ln.tail[rem] = 0x80;
+        uint64_t bits = (uint64_t)len << 3;
+        for (int i = 0; i < 8; ++i)
+            ln.tail[ln.tailBlocks * 64 - 8 + i] = (uint8_t)(bits >> (8 * i));
+        stLane[0 * L + l] = 0x67452301;
+        stLane[1 * L + l] = 0xefcdab89;
+        stLane[2 * L + l] = 0x98badcfe;
+        stLane[3 * L + l] = 0x10325476;
+    };
+    int active = 0;
+    for (int l = 0; l < L; ++l) {
+        start(l);
+        active += lane[l].active;
+    }
+
+    while (active > 0) {
+        /* 2.transpose the current block of every lane into word-major order */
+        for (int l = 0; l < L; ++l) {
+            const MD5BatchLane& ln = lane[l];
+            const uint8_t* block = !ln.active ? idle : ln.blocks ? ln.data : ln.tail + ln.tailPos * 64;
+            uint32_t w[16];
+            memcpy(w, block, 64);
+            for (int i = 0; i < 16; ++i)
+                xLane[i * L + l] = w[i];
+        }
+
+        md5BatchTransform(st, x);
+
+        /* 3.advance every lane, a finished lane writes its digest and takes the next message */
+        for (int l = 0; l < L; ++l) {
+            MD5BatchLane& ln = lane[l];
+            if (!ln.active)
+                continue;
+            if (ln.blocks) {
+                ln.data += 64;
+                ln.blocks--;
+                continue;
+            }
+            if (++ln.tailPos < ln.tailBlocks)
+                continue;
+            for (int i = 0; i < 4; ++i) {
+                uint32_t v = stLane[i * L + l];
+                uint8_t* out = digests + ln.msg * 16 + i * 4;
+                out[0] = (uint8_t)v;
+                out[1] = (uint8_t)(v >> 8);
+                out[2] = (uint8_t)(v >> 16);
+                out[3] = (uint8_t)(v >> 24);
+            }
+            start(l);
+            active -= !ln.active;
+        }
+    }
+}
+
+__attribute__((target("sse2"))) inline void md5BatchSSE2(const void* const* messages, const size_t* lens, size_t n, uint8_t* digests) {
+    md5BatchKernel<MD5x4>(messages, lens, n, digests);
+}
+__attribute__((target("avx2"))) inline void md5BatchAVX2(const void* const* messages, const size_t* lens, size_t n, uint8_t* digests) {
+    md5BatchKernel<MD5x8>(messages, lens, n, digests);
+}
+__attribute__((target("avx512f"))) inline void md5BatchAVX512(const void* const* messages, const size_t* lens, size_t n, uint8_t* digests) {
+    md5BatchKernel<MD5x16>(messages, lens, n, digests);
+}
+
+}
+#endif
+
+/*
+* @Hash n independent messages at once.
+*
+* @param {messages} pointers to the messages.
+*
+* @param {lens} the number byte of each message.
+*
+* @param {digests} output, 16 bytes per message in input order.
+*/
+inline void md5Batch(const void* const* messages, const size_t* lens, size_t n, uint8_t* digests) {
+#ifdef MESSAGEDIGEST_HAS_MD5_BATCH_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        detail::md5BatchAVX512(messages, lens, n, digests);
+    else if (__builtin_cpu_supports("avx2"))
+        detail::md5BatchAVX2(messages, lens, n, digests);
+    else if (__builtin_cpu_supports("sse2"))
+        detail::md5BatchSSE2(messages, lens, n, digests);
+    else
+#endif
+    {
+        for (size_t i = 0; i < n; ++i) {
+            MD5::Result digest = MD5().update(messages[i], lens[i]).digestArray();
+            memcpy(digests + i * 16, digest.data(), 16);
+        }
+    }
+}
+
+/*
+* @Hash n independent messages to hex keys, nothing is allocated per message.
+*
+* @param {hex} output, 32 chars per message in input order, no terminators.
+*/
+inline void md5BatchHex(const void* const* messages, const size_t* lens, size_t n, char* hex) {
+    /* a chunk large enough to fill the widest kernel, small enough to stay in L1 */
+    const size_t chunk = 64;
+    uint8_t digests[chunk * 16];
+    for (size_t i = 0; i < n; i += chunk) {
+        size_t count = n - i < chunk ? n - i : chunk;
+        md5Batch(messages + i, lens + i, count, digests);
+        toHex(digests, count * 16, hex + i * 32);
+    }
+}
+
+}
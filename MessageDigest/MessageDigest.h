@@ -1,7 +1,26 @@
 #pragma once
 #include <string>
 #include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <cerrno>
 #include <vector>
+#include <array>
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#include <string_view>
+#define MESSAGEDIGEST_HAS_STRING_VIEW 1
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define MESSAGEDIGEST_HAS_MMAP 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MESSAGEDIGEST_HAS_SSE2 1
+#endif
 
 namespace MessageDigest
 {
@@ -9,6 +28,83 @@ namespace MessageDigest
 using std::string;
 using std::vector;
 
+/*
+* @Write the lowercase hex form of bytes to out, 2 * len chars without terminator.
+* 16 bytes per step with SSE2, a 256-entry pair table otherwise.
+*
+* @param {out} caller buffer of at least 2 * len chars.
+*/
+inline void toHex(const uint8_t* bytes, size_t len, char* out) {
+    size_t i = 0;
+#ifdef MESSAGEDIGEST_HAS_SSE2
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i zero = _mm_set1_epi8('0');
+    const __m128i gap = _mm_set1_epi8('a' - '0' - 10);
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(bytes + i));
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+        __m128i lo = _mm_and_si128(v, mask);
+        /* nibble n becomes '0' + n, plus the gap to 'a' when n > 9 */
+        hi = _mm_add_epi8(_mm_add_epi8(hi, zero), _mm_and_si128(_mm_cmpgt_epi8(hi, nine), gap));
+        lo = _mm_add_epi8(_mm_add_epi8(lo, zero), _mm_and_si128(_mm_cmpgt_epi8(lo, nine), gap));
+        _mm_storeu_si128((__m128i*)(out + 2 * i), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i*)(out + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+#endif
+    struct PairTable {
+        char pairs[256][2];
+        PairTable() {
+            static const char hex[] = "0123456789abcdef";
+            for (int b = 0; b < 256; ++b) {
+                pairs[b][0] = hex[b >> 4];
+                pairs[b][1] = hex[b & 0xf];
+            }
+        }
+    };
+    static const PairTable table;
+    for (; i < len; ++i)
+        memcpy(out + 2 * i, table.pairs[bytes[i]], 2);
+}
+
+/*
+* Common interface of all digests, e.g. MD5, SHA1, SHA256, CRC32C and XXH64 (see Digests.h)
+* finalize() returns the digest of the input so far, update() may continue afterwards
+*/
+class Digest {
+public:
+    virtual ~Digest() {}
+    virtual void reset() = 0;
+    virtual Digest &update(const void* input, size_t len) = 0;
+    Digest &update(const string& input) {
+        return update(input.data(), input.length());
+    }
+    /* string literals would be ambiguous between string and string_view */
+    Digest &update(const char* input) {
+        return update(input, strlen(input));
+    }
+#ifdef MESSAGEDIGEST_HAS_STRING_VIEW
+    Digest &update(std::string_view input) {
+        return update(input.data(), input.length());
+    }
+#endif
+    virtual vector<uint8_t> finalize() = 0;
+    /* number of bytes returned by finalize() */
+    virtual size_t size() const = 0;
+    virtual string toString() {
+        return toHex(finalize());
+    }
+
+    /*
+    * @Convert bytes to the lowercase hex string.
+    */
+    static string toHex(const vector<uint8_t>& bytes) {
+        string str(bytes.size() * 2, '\0');
+        MessageDigest::toHex(bytes.data(), bytes.size(), &str[0]);
+        return str;
+    }
+};
+
 /*
 * Original Author: JieweiWei
 * Modified by: JasonYuchen
@@ -72,16 +168,124 @@ inline constexpr void II(uint32_t &a, uint32_t b, uint32_t c, uint32_t d, uint32
 }
 
 
-class MD5 {
+/*
+* @MD5 basic transformation of one decoded block, constexpr so that compile-time hashing shares it.
+*
+* @param {state} ABCD, updated in place.
+*
+* @param {x} the 16 little-endian words of the block.
+*/
+inline constexpr void md5Transform(uint32_t* state, const uint32_t* x) {
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+
+    /* Round 1 */
+    FF(a, b, c, d, x[0], s11, 0xd76aa478U);
+    FF(d, a, b, c, x[1], s12, 0xe8c7b756U);
+    FF(c, d, a, b, x[2], s13, 0x242070dbU);
+    FF(b, c, d, a, x[3], s14, 0xc1bdceeeU);
+    FF(a, b, c, d, x[4], s11, 0xf57c0fafU);
+    FF(d, a, b, c, x[5], s12, 0x4787c62aU);
+    FF(c, d, a, b, x[6], s13, 0xa8304613U);
+    FF(b, c, d, a, x[7], s14, 0xfd469501U);
+    FF(a, b, c, d, x[8], s11, 0x698098d8U);
+    FF(d, a, b, c, x[9], s12, 0x8b44f7afU);
+    FF(c, d, a, b, x[10], s13, 0xffff5bb1U);
+    FF(b, c, d, a, x[11], s14, 0x895cd7beU);
+    FF(a, b, c, d, x[12], s11, 0x6b901122U);
+    FF(d, a, b, c, x[13], s12, 0xfd987193U);
+    FF(c, d, a, b, x[14], s13, 0xa679438eU);
+    FF(b, c, d, a, x[15], s14, 0x49b40821U);
+
+    /* Round 2 */
+    GG(a, b, c, d, x[1], s21, 0xf61e2562U);
+    GG(d, a, b, c, x[6], s22, 0xc040b340U);
+    GG(c, d, a, b, x[11], s23, 0x265e5a51U);
+    GG(b, c, d, a, x[0], s24, 0xe9b6c7aaU);
+    GG(a, b, c, d, x[5], s21, 0xd62f105dU);
+    GG(d, a, b, c, x[10], s22, 0x02441453U);
+    GG(c, d, a, b, x[15], s23, 0xd8a1e681U);
+    GG(b, c, d, a, x[4], s24, 0xe7d3fbc8U);
+    GG(a, b, c, d, x[9], s21, 0x21e1cde6U);
+    GG(d, a, b, c, x[14], s22, 0xc33707d6U);
+    GG(c, d, a, b, x[3], s23, 0xf4d50d87U);
+    GG(b, c, d, a, x[8], s24, 0x455a14edU);
+    GG(a, b, c, d, x[13], s21, 0xa9e3e905U);
+    GG(d, a, b, c, x[2], s22, 0xfcefa3f8U);
+    GG(c, d, a, b, x[7], s23, 0x676f02d9U);
+    GG(b, c, d, a, x[12], s24, 0x8d2a4c8aU);
+
+    /* Round 3 */
+    HH(a, b, c, d, x[5], s31, 0xfffa3942U);
+    HH(d, a, b, c, x[8], s32, 0x8771f681U);
+    HH(c, d, a, b, x[11], s33, 0x6d9d6122U);
+    HH(b, c, d, a, x[14], s34, 0xfde5380cU);
+    HH(a, b, c, d, x[1], s31, 0xa4beea44U);
+    HH(d, a, b, c, x[4], s32, 0x4bdecfa9U);
+    HH(c, d, a, b, x[7], s33, 0xf6bb4b60U);
+    HH(b, c, d, a, x[10], s34, 0xbebfbc70U);
+    HH(a, b, c, d, x[13], s31, 0x289b7ec6U);
+    HH(d, a, b, c, x[0], s32, 0xeaa127faU);
+    HH(c, d, a, b, x[3], s33, 0xd4ef3085U);
+    HH(b, c, d, a, x[6], s34, 0x04881d05U);
+    HH(a, b, c, d, x[9], s31, 0xd9d4d039U);
+    HH(d, a, b, c, x[12], s32, 0xe6db99e5U);
+    HH(c, d, a, b, x[15], s33, 0x1fa27cf8U);
+    HH(b, c, d, a, x[2], s34, 0xc4ac5665U);
+
+    /* Round 4 */
+    II(a, b, c, d, x[0], s41, 0xf4292244U);
+    II(d, a, b, c, x[7], s42, 0x432aff97U);
+    II(c, d, a, b, x[14], s43, 0xab9423a7U);
+    II(b, c, d, a, x[5], s44, 0xfc93a039U);
+    II(a, b, c, d, x[12], s41, 0x655b59c3U);
+    II(d, a, b, c, x[3], s42, 0x8f0ccc92U);
+    II(c, d, a, b, x[10], s43, 0xffeff47dU);
+    II(b, c, d, a, x[1], s44, 0x85845dd1U);
+    II(a, b, c, d, x[8], s41, 0x6fa87e4fU);
+    II(d, a, b, c, x[15], s42, 0xfe2ce6e0U);
+    II(c, d, a, b, x[6], s43, 0xa3014314U);
+    II(b, c, d, a, x[13], s44, 0x4e0811a1U);
+    II(a, b, c, d, x[4], s41, 0xf7537e82U);
+    II(d, a, b, c, x[11], s42, 0xbd3af235U);
+    II(c, d, a, b, x[2], s43, 0x2ad7d2bbU);
+    II(b, c, d, a, x[9], s44, 0xeb86d391U);
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+}
+
+
+class MD5 : public Digest {
 public:
+    typedef std::array<uint8_t, 16> Result;
+
     /*
     * @Generate a MD5 instance with lazy evaluation
     *
     * @example: MD5("test MD5 algorithm").digest().toString()
     */
     MD5(const string& message) {
+        reset();
+        init((const uint8_t*)message.data(), message.length());
+    }
+
+    /*
+    * @Generate an empty MD5 instance for streaming input
+    *
+    * @example: MD5 md5; md5.update(part1, len1).update(part2, len2); md5.finalize();
+    */
+    MD5() {
+        reset();
+    }
+
+    /*
+    * @Restart from the empty message.
+    */
+    void reset() override {
         finished = false;
-        haveString = false;
         /* Reset number of bits. */
         count[0] = count[1] = 0;
         /* Initialization constants. */
@@ -89,25 +293,163 @@ public:
         state[1] = 0xefcdab89;
         state[2] = 0x98badcfe;
         state[3] = 0x10325476;
+    }
 
-        init((const uint8_t*)message.c_str(), message.length());
+    /*
+    * @Append input to the message, no copy of the input is kept.
+    *
+    * @param {input} the next bytes of the message.
+    *
+    * @param {len} the number byte of input.
+    */
+    MD5 &update(const void* input, size_t len) override {
+        init((const uint8_t*)input, len);
+        return *this;
+    }
+    MD5 &update(const string& input) {
+        return update(input.data(), input.length());
+    }
+    MD5 &update(const char* input) {
+        return update(input, strlen(input));
     }
+#ifdef MESSAGEDIGEST_HAS_STRING_VIEW
+    MD5 &update(std::string_view input) {
+        return update(input.data(), input.length());
+    }
+#endif
 
+    /*
+    * @Append the content of a file, the memory used does not depend on the file size.
+    * POSIX maps the file window by window, other platforms use large buffered reads.
+    *
+    * @param {path} the file path.
+    *
+    * @return false if the file cannot be opened or read, the digest is then undefined.
+    */
+    bool updateFile(const string& path);
+
+    /*
+    * @Number of bytes appended since the last reset.
+    */
+    uint64_t bytesHashed() const {
+        return (((uint64_t)count[1] << 32) | count[0]) >> 3;
+    }
+
+    /*
+    * @Export the mid-stream context so that another MD5, possibly in another process or
+    * on another machine, continues from bytesHashed() without re-reading the input.
+    * The image is 96 little-endian bytes: magic, version, bit count, ABCD and the partial block.
+    *
+    * @example: MD5 a; a.update(part1); auto image = a.snapshot(); MD5 b; b.restore(image); b.update(part2);
+    */
+    static const size_t SnapshotSize = 96;
+    size_t snapshotSize() const {
+        return SnapshotSize;
+    }
+    void snapshot(char* out) const {
+        uint8_t* p = (uint8_t*)out;
+        uint32_t header[2] = { SnapshotMagic, SnapshotVersion };
+        encode(header, p, 8);
+        encode(count, p + 8, 8);
+        encode(state, p + 16, 16);
+        /* only the pending bytes, never stale input from earlier blocks */
+        size_t pending = (size_t)(bytesHashed() & 0x3f);
+        memcpy(p + 32, buffer, pending);
+        memset(p + 32 + pending, 0, 64 - pending);
+    }
+    vector<char> snapshot() const {
+        vector<char> image(SnapshotSize);
+        snapshot(image.data());
+        return image;
+    }
+
+    /*
+    * @Continue from an exported context, the current context is kept if the image is rejected.
+    *
+    * @return false if the image is truncated or from an unknown format.
+    */
+    bool restore(const char* in, size_t len) {
+        const uint8_t* p = (const uint8_t*)in;
+        if (len < SnapshotSize)
+            return false;
+        uint32_t header[2];
+        decode(p, header, 8);
+        if (header[0] != SnapshotMagic || header[1] != SnapshotVersion)
+            return false;
+        decode(p + 8, count, 8);
+        decode(p + 16, state, 16);
+        memcpy(buffer, p + 32, 64);
+        finished = false;
+        return true;
+    }
+    bool restore(const vector<char>& image) {
+        return restore(image.data(), image.size());
+    }
+
+    /*
+    * @Digest of all the input so far, more input may still be appended afterwards.
+    */
+    vector<uint8_t> finalize() override {
+        return digest();
+    }
 
     vector<uint8_t> digest() {
+        const uint8_t* bytes = compute();
+        return vector<uint8_t>(bytes, bytes + 16);
+    }
+
+    /*
+    * @Same as digest() without a heap allocation.
+    */
+    Result digestArray() {
+        Result bytes;
+        memcpy(bytes.data(), compute(), 16);
+        return bytes;
+    }
+
+    /*
+    * @Write the 32 hex chars of the digest to out, no terminator.
+    */
+    void toHex(char* out) {
+        MessageDigest::toHex(compute(), 16, out);
+    }
+    using Digest::toHex;
+
+    /*
+    * @Convert digest to string value.
+    *
+    * @return the hex string of digest.
+    */
+    string toString() override {
+        string str(32, '\0');
+        toHex(&str[0]);
+        return str;
+    }
+
+    size_t size() const override {
+        return 16;
+    }
+
+private:
+    /*
+    * @Pad a copy of the context and store the digest in result, cached until the next update.
+    */
+    const uint8_t* compute() {
         if (finished)
-            return result_vec;
+            return result;
 
         finished = true;
 
         uint8_t bits[8];
         uint32_t oldState[4];
         uint32_t oldCount[2];
+        uint8_t oldBuffer[64];
         uint32_t index, padLen;
 
-        /* Save current state and count. */
+        /* Save current state, count and the buffered partial block. */
         memcpy(oldState, state, 16);
         memcpy(oldCount, count, 8);
+        memcpy(oldBuffer, buffer, 64);
 
         /* Save number of bits */
         encode(count, bits, 8);
@@ -115,7 +457,7 @@ public:
         /* Pad out to 56 mod 64. */
         index = (uint32_t)((count[0] >> 3) & 0x3f);
         padLen = (index < 56) ? (56 - index) : (120 - index);
-        init(PADDING, padLen);
+        init(padding(), padLen);
 
         /* Append length (before padding) */
         init(bits, 8);
@@ -123,38 +465,14 @@ public:
         /* Store state in digest */
         encode(state, result, 16);
 
-        /* Restore current state and count. */
+        /* Restore current state, count and buffer so that update() may continue. */
         memcpy(state, oldState, 16);
         memcpy(count, oldCount, 8);
+        memcpy(buffer, oldBuffer, 64);
 
-        result_vec = vector<uint8_t>(&result[0], &result[16]);
-
-        return result_vec;
+        return result;
     }
 
-    /*
-    * @Convert digest to string value.
-    *
-    * @return the hex string of digest.
-    */
-    string toString() {
-        if (haveString)
-            return result_str;
-
-        haveString = true;
-
-        digest();
-        result_str.reserve(16 << 1);
-        for (const auto &val : result) {
-            int a = val / 16;
-            int b = val % 16;
-            result_str.append(1, HEX_NUMBERS[a]);
-            result_str.append(1, HEX_NUMBERS[b]);
-        }
-        return result_str;
-    }
-
-private:
     /*
     * @Initialization the md5 object, processing another message block,
     * and updating the context.
@@ -165,18 +483,20 @@ private:
     */
     void init(const uint8_t* input, size_t len) {
 
-        uint32_t i, index, partLen;
+        size_t i;
+        uint32_t index, partLen;
 
         finished = false;
 
         /* Compute number of bytes mod 64 */
         index = (uint32_t)((count[0] >> 3) & 0x3f);
 
-        /* update number of bits */
-        if ((count[0] += ((uint32_t)len << 3)) < ((uint32_t)len << 3)) {
+        /* update number of bits, len may exceed 4 GB */
+        uint64_t bits = (uint64_t)len << 3;
+        if ((count[0] += (uint32_t)bits) < (uint32_t)bits) {
             ++count[1];
         }
-        count[1] += ((uint32_t)len >> 29);
+        count[1] += (uint32_t)(bits >> 32);
 
         partLen = 64 - index;
 
@@ -197,7 +517,8 @@ private:
         }
 
         /* Buffer remaining input */
-        memcpy(&buffer[index], &input[i], len - i);
+        if (len > i)
+            memcpy(&buffer[index], &input[i], len - i);
     }
 
     /*
@@ -206,87 +527,9 @@ private:
     * @param {block} the message block.
     */
     void transform(const uint8_t block[64]) {
-
-        uint32_t a = state[0], b = state[1], c = state[2], d = state[3], x[16];
-
+        uint32_t x[16];
         decode(block, x, 64);
-
-        /* Round 1 */
-        FF(a, b, c, d, x[0], s11, 0xd76aa478U);
-        FF(d, a, b, c, x[1], s12, 0xe8c7b756U);
-        FF(c, d, a, b, x[2], s13, 0x242070dbU);
-        FF(b, c, d, a, x[3], s14, 0xc1bdceeeU);
-        FF(a, b, c, d, x[4], s11, 0xf57c0fafU);
-        FF(d, a, b, c, x[5], s12, 0x4787c62aU);
-        FF(c, d, a, b, x[6], s13, 0xa8304613U);
-        FF(b, c, d, a, x[7], s14, 0xfd469501U);
-        FF(a, b, c, d, x[8], s11, 0x698098d8U);
-        FF(d, a, b, c, x[9], s12, 0x8b44f7afU);
-        FF(c, d, a, b, x[10], s13, 0xffff5bb1U);
-        FF(b, c, d, a, x[11], s14, 0x895cd7beU);
-        FF(a, b, c, d, x[12], s11, 0x6b901122U);
-        FF(d, a, b, c, x[13], s12, 0xfd987193U);
-        FF(c, d, a, b, x[14], s13, 0xa679438eU);
-        FF(b, c, d, a, x[15], s14, 0x49b40821U);
-
-        /* Round 2 */
-        GG(a, b, c, d, x[1], s21, 0xf61e2562U);
-        GG(d, a, b, c, x[6], s22, 0xc040b340U);
-        GG(c, d, a, b, x[11], s23, 0x265e5a51U);
-        GG(b, c, d, a, x[0], s24, 0xe9b6c7aaU);
-        GG(a, b, c, d, x[5], s21, 0xd62f105dU);
-        GG(d, a, b, c, x[10], s22, 0x02441453U);
-        GG(c, d, a, b, x[15], s23, 0xd8a1e681U);
-        GG(b, c, d, a, x[4], s24, 0xe7d3fbc8U);
-        GG(a, b, c, d, x[9], s21, 0x21e1cde6U);
-        GG(d, a, b, c, x[14], s22, 0xc33707d6U);
-        GG(c, d, a, b, x[3], s23, 0xf4d50d87U);
-        GG(b, c, d, a, x[8], s24, 0x455a14edU);
-        GG(a, b, c, d, x[13], s21, 0xa9e3e905U);
-        GG(d, a, b, c, x[2], s22, 0xfcefa3f8U);
-        GG(c, d, a, b, x[7], s23, 0x676f02d9U);
-        GG(b, c, d, a, x[12], s24, 0x8d2a4c8aU);
-
-        /* Round 3 */
-        HH(a, b, c, d, x[5], s31, 0xfffa3942U);
-        HH(d, a, b, c, x[8], s32, 0x8771f681U);
-        HH(c, d, a, b, x[11], s33, 0x6d9d6122U);
-        HH(b, c, d, a, x[14], s34, 0xfde5380cU);
-        HH(a, b, c, d, x[1], s31, 0xa4beea44U);
-        HH(d, a, b, c, x[4], s32, 0x4bdecfa9U);
-        HH(c, d, a, b, x[7], s33, 0xf6bb4b60U);
-        HH(b, c, d, a, x[10], s34, 0xbebfbc70U);
-        HH(a, b, c, d, x[13], s31, 0x289b7ec6U);
-        HH(d, a, b, c, x[0], s32, 0xeaa127faU);
-        HH(c, d, a, b, x[3], s33, 0xd4ef3085U);
-        HH(b, c, d, a, x[6], s34, 0x04881d05U);
-        HH(a, b, c, d, x[9], s31, 0xd9d4d039U);
-        HH(d, a, b, c, x[12], s32, 0xe6db99e5U);
-        HH(c, d, a, b, x[15], s33, 0x1fa27cf8U);
-        HH(b, c, d, a, x[2], s34, 0xc4ac5665U);
-
-        /* Round 4 */
-        II(a, b, c, d, x[0], s41, 0xf4292244U);
-        II(d, a, b, c, x[7], s42, 0x432aff97U);
-        II(c, d, a, b, x[14], s43, 0xab9423a7U);
-        II(b, c, d, a, x[5], s44, 0xfc93a039U);
-        II(a, b, c, d, x[12], s41, 0x655b59c3U);
-        II(d, a, b, c, x[3], s42, 0x8f0ccc92U);
-        II(c, d, a, b, x[10], s43, 0xffeff47dU);
-        II(b, c, d, a, x[1], s44, 0x85845dd1U);
-        II(a, b, c, d, x[8], s41, 0x6fa87e4fU);
-        II(d, a, b, c, x[15], s42, 0xfe2ce6e0U);
-        II(c, d, a, b, x[6], s43, 0xa3014314U);
-        II(b, c, d, a, x[13], s44, 0x4e0811a1U);
-        II(a, b, c, d, x[4], s41, 0xf7537e82U);
-        II(d, a, b, c, x[11], s42, 0xbd3af235U);
-        II(c, d, a, b, x[2], s43, 0x2ad7d2bbU);
-        II(b, c, d, a, x[9], s44, 0xeb86d391U);
-
-        state[0] += a;
-        state[1] += b;
-        state[2] += c;
-        state[3] += d;
+        md5Transform(state, x);
     }
 
 
@@ -299,7 +542,7 @@ private:
     *
     * @param {length} the length of input.
     */
-    void encode(const uint32_t* input, uint8_t* output, size_t length) {
+    static void encode(const uint32_t* input, uint8_t* output, size_t length) {
 
         for (size_t i = 0, j = 0; j < length; ++i, j += 4) {
             output[j] = (uint8_t)(input[i] & 0xff);
@@ -318,7 +561,7 @@ private:
     *
     * @param {length} the length of input.
     */
-    void decode(const uint8_t* input, uint32_t* output, size_t length) {
+    static void decode(const uint8_t* input, uint32_t* output, size_t length) {
         for (size_t i = 0, j = 0; j < length; ++i, j += 4) {
             output[i] = ((uint32_t)input[j]) | (((uint32_t)input[j + 1]) << 8) |
                 (((uint32_t)input[j + 2]) << 16) | (((uint32_t)input[j + 3]) << 24);
@@ -329,7 +572,6 @@ private:
 private:
     /* Flag for mark whether calculate finished. */
     bool finished;
-    bool haveString;
 
     /* state (ABCD). */
     uint32_t state[4];
@@ -342,22 +584,73 @@ private:
 
     /* message digest. */
     uint8_t result[16];
-    vector<uint8_t> result_vec;
-    string result_str;
 
-    /* padding for calculate. */
-    static const uint8_t PADDING[64];
+    /* padding for calculate, a function-local static so the header can be included from many translation units. */
+    static const uint8_t* padding() {
+        static const uint8_t bytes[64] = { 0x80 };
+        return bytes;
+    }
 
-    /* Hex numbers. */
-    static const char HEX_NUMBERS[16];
+    /* "MD5C" and the snapshot layout version. */
+    static const uint32_t SnapshotMagic = 0x4335444d;
+    static const uint32_t SnapshotVersion = 1;
 };
 
-const uint8_t MD5::PADDING[64] = { 0x80 };
-const char MD5::HEX_NUMBERS[16] = {
-    '0', '1', '2', '3',
-    '4', '5', '6', '7',
-    '8', '9', 'a', 'b',
-    'c', 'd', 'e', 'f'
-};
+inline bool MD5::updateFile(const string& path) {
+#ifdef MESSAGEDIGEST_HAS_MMAP
+    /* map 64 MB at a time so address space and resident pages stay bounded */
+    const size_t window = (size_t)64 << 20;
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    /* only regular files have a trustworthy size, procfs/sysfs report 0 and pipes or devices have none */
+    size_t size = S_ISREG(st.st_mode) ? (size_t)st.st_size : 0;
+    size_t offset = 0;
+    while (offset < size) {
+        size_t len = size - offset < window ? size - offset : window;
+        void* data = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, (off_t)offset);
+        if (data == MAP_FAILED)
+            break;
+        madvise(data, len, MADV_SEQUENTIAL);
+        update(data, len);
+        munmap(data, len);
+        offset += len;
+    }
+    /* whatever was not mapped is read, 1 MB at a time */
+    bool ok = offset == 0 || lseek(fd, (off_t)offset, SEEK_SET) == (off_t)offset;
+    vector<uint8_t> buf;
+    while (ok) {
+        if (buf.empty())
+            buf.resize((size_t)1 << 20);
+        ssize_t len = read(fd, buf.data(), buf.size());
+        if (len < 0 && errno == EINTR)
+            continue;
+        if (len <= 0) {
+            ok = len == 0;
+            break;
+        }
+        update(buf.data(), (size_t)len);
+    }
+    close(fd);
+    return ok;
+#else
+    /* 1 MB reads keep the syscall count low and the whole block loop in transform() */
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+    vector<uint8_t> buf((size_t)1 << 20);
+    size_t len;
+    while ((len = fread(buf.data(), 1, buf.size(), file)) > 0)
+        update(buf.data(), len);
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+#endif
+}
 
 }
\ No newline at end of file
@@ -0,0 +1,215 @@
+#pragma once
+#include <atomic>
+#include <thread>
+#include "MessageDigest.h"
+
+namespace MessageDigest
+{
+
+/*
+* Chunked MD5 in the style of S3 multipart ETags
+* The input is cut into fixed-size parts, the parts are hashed concurrently,
+* and the combined digest is MD5(digest(part 1) || ... || digest(part N)) printed as "<hex>-N"
+* The ETag only matches S3 when partSize equals the part size used for the upload
+*/
+class MultipartMD5 {
+public:
+    /*
+    * @param {partSize} bytes per part, S3 tools default to 8 MB.
+    *
+    * @param {threads} worker count, 0 uses every hardware thread.
+    */
+    explicit MultipartMD5(size_t partSize = (size_t)8 << 20, unsigned threads = 0)
+        : partSize(partSize ? partSize : 1), threads(threads) {
+        if (this->threads == 0)
+            this->threads = std::thread::hardware_concurrency();
+        if (this->threads == 0)
+            this->threads = 1;
+    }
+
+    /*
+    * @Hash a buffer already in memory, replaces any previous result.
+    */
+    void hash(const void* input, size_t len) {
+        const uint8_t* data = (const uint8_t*)input;
+        run(len, [&](size_t offset, size_t n, MD5 &md5) {
+            md5.update(data + offset, n);
+            return true;
+        });
+    }
+
+    /*
+    * @Hash a file, every worker reads its own parts so the disk sees parallel requests.
+    *
+    * @return false if the file cannot be opened or read, the result is then undefined.
+    */
+    bool hashFile(const string& path);
+
+    /*
+    * @Digest of each part in order.
+    */
+    const vector<vector<uint8_t>> &partDigests() const {
+        return parts;
+    }
+
+    size_t partCount() const {
+        return parts.size();
+    }
+
+    /*
+    * @MD5 of the concatenated part digests.
+    */
+    vector<uint8_t> digest() const {
+        MD5 md5;
+        for (const vector<uint8_t> &part : parts)
+            md5.update(part.data(), part.size());
+        return md5.finalize();
+    }
+
+    /*
+    * @The ETag form "<hex>-<part count>".
+    */
+    string toString() const {
+        return Digest::toHex(digest()) + "-" + std::to_string(parts.size());
+    }
+
+private:
+    /*
+    * Split [0,len) into parts and let the workers claim them one by one.
+    * An empty input is one empty part, like an upload of an empty object.
+    */
+    template<typename HashPart>
+    bool run(size_t len, HashPart hashPart) {
+        size_t count = len == 0 ? 1 : (len - 1) / partSize + 1;
+        parts.assign(count, vector<uint8_t>());
+        std::atomic<size_t> next(0);
+        std::atomic<bool> ok(true);
+        auto worker = [&]() {
+            MD5 md5;
+            for (size_t i = next++; i < count && ok; i = next++) {
+                size_t offset = i * partSize;
+                size_t n = len - offset < partSize ? len - offset : partSize;
+                md5.reset();
+                if (!hashPart(offset, n, md5))
+                    ok = false;
+                parts[i] = md5.finalize();
+            }
+        };
+        size_t workers = threads < count ? threads : count;
+        vector<std::thread> pool;
+        for (size_t t = 1; t < workers; ++t)
+            pool.emplace_back(worker);
+        worker();
+        for (std::thread &t : pool)
+            t.join();
+        return ok;
+    }
+
+#ifdef MESSAGEDIGEST_HAS_MMAP
+    /* a stream without a known size is read sequentially on this thread and cut every partSize bytes */
+    bool readParts(int fd) {
+        parts.clear();
+        vector<uint8_t> buf((size_t)1 << 20);
+        MD5 md5;
+        size_t inPart = 0;
+        for (;;) {
+            ssize_t len = read(fd, buf.data(), buf.size());
+            if (len < 0 && errno == EINTR)
+                continue;
+            if (len < 0)
+                return false;
+            if (len == 0)
+                break;
+            const uint8_t* data = buf.data();
+            size_t n = (size_t)len;
+            while (n > 0) {
+                size_t take = partSize - inPart < n ? partSize - inPart : n;
+                md5.update(data, take);
+                data += take;
+                n -= take;
+                inPart += take;
+                if (inPart == partSize) {
+                    parts.push_back(md5.finalize());
+                    md5.reset();
+                    inPart = 0;
+                }
+            }
+        }
+        if (inPart > 0 || parts.empty())
+            parts.push_back(md5.finalize());
+        return true;
+    }
+#endif
+
+    size_t partSize;
+    unsigned threads;
+    vector<vector<uint8_t>> parts;
+};
+
+inline bool MultipartMD5::hashFile(const string& path) {
+#ifdef MESSAGEDIGEST_HAS_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    /* only regular files have a trustworthy size, procfs/sysfs report 0 and pipes or devices have none */
+    if (!S_ISREG(st.st_mode) || st.st_size == 0) {
+        bool ok = readParts(fd);
+        close(fd);
+        return ok;
+    }
+    /* map one part at a time, offsets must stay page aligned */
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    bool ok = run((size_t)st.st_size, [&](size_t offset, size_t n, MD5 &md5) {
+        size_t skew = offset % page;
+        void* data = mmap(nullptr, n + skew, PROT_READ, MAP_PRIVATE, fd, (off_t)(offset - skew));
+        if (data != MAP_FAILED) {
+            madvise(data, n + skew, MADV_SEQUENTIAL);
+            md5.update((const uint8_t*)data + skew, n);
+            munmap(data, n + skew);
+            return true;
+        }
+        /* the part cannot be mapped, read it instead */
+        vector<uint8_t> buf(n < ((size_t)1 << 20) ? n : ((size_t)1 << 20));
+        while (n > 0) {
+            ssize_t len = pread(fd, buf.data(), n < buf.size() ? n : buf.size(), (off_t)offset);
+            if (len < 0 && errno == EINTR)
+                continue;
+            if (len <= 0)
+                return false;
+            md5.update(buf.data(), (size_t)len);
+            offset += (size_t)len;
+            n -= (size_t)len;
+        }
+        return true;
+    });
+    close(fd);
+    return ok;
+#else
+    /* without positional reads the file is read sequentially on this thread */
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+    parts.clear();
+    vector<uint8_t> buf(partSize);
+    MD5 md5;
+    size_t len;
+    while ((len = fread(buf.data(), 1, buf.size(), file)) > 0) {
+        md5.reset();
+        parts.push_back(md5.update(buf.data(), len).finalize());
+        if (len < buf.size())
+            break;
+    }
+    if (parts.empty())
+        parts.push_back(md5.finalize());
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+#endif
+}
+
+}
@@ -0,0 +1,332 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include "MessageDigest.h"
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#include <cpuid.h>
+#define MESSAGEDIGEST_HAS_SHA_NI 1
+#endif
+
+namespace MessageDigest
+{
+
+/*
+* SHA-1 and SHA-256 (FIPS 180-4)
+* Blocks are compressed with the SHA-NI instructions when the CPU has them, otherwise in plain C++
+*/
+
+namespace detail
+{
+
+inline uint32_t rotr32(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+inline uint32_t loadBE32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+inline void storeBE32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static const uint32_t SHA256_IV[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+static const uint32_t SHA1_IV[5] = {
+    0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0
+};
+
+alignas(16) static const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+inline void sha256Scalar(uint32_t* state, const uint8_t* data, size_t blocks) {
+    for (; blocks > 0; --blocks, data += 64) {
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i)
+            w[i] = loadBE32(data + i * 4);
+        for (int i = 16; i < 64; ++i) {
+            uint32_t s0 = rotr32(w[i - 15], 7) ^ rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr32(w[i - 2], 17) ^ rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; ++i) {
+            uint32_t t1 = h + (rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i];
+            uint32_t t2 = (rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+inline void sha1Scalar(uint32_t* state, const uint8_t* data, size_t blocks) {
+    for (; blocks > 0; --blocks, data += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i)
+            w[i] = loadBE32(data + i * 4);
+        for (int i = 16; i < 80; ++i)
+            w[i] = rotr32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 31);
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+        for (int i = 0; i < 80; ++i) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5a827999;
+            }
+            else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ed9eba1;
+            }
+            else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8f1bbcdc;
+            }
+            else {
+                f = b ^ c ^ d;
+                k = 0xca62c1d6;
+            }
+            uint32_t t = rotr32(a, 27) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotr32(b, 2);
+            b = a;
+            a = t;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+    }
+}
+
+#ifdef MESSAGEDIGEST_HAS_SHA_NI
+inline bool cpuHasSHA() {
+    unsigned a, b, c, d;
+    if (!__get_cpuid_count(7, 0, &a, &b, &c, &d))
+        return false;
+    /* SHA is leaf 7 EBX bit 29, the kernels also use SSSE3/SSE4.1 which every SHA CPU has */
+    return (b >> 29) & 1;
+}
+
+__attribute__((target("sha,sse4.1"))) inline void sha256SHANI(uint32_t* state, const uint8_t* data, size_t blocks) {
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    /* 1.the instructions want the state as ABEF/CDGH */
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[0]), 0xB1);
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[4]), 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    for (; blocks > 0; --blocks, data += 64) {
+        __m128i abefSave = state0, cdghSave = state1;
+        __m128i w[4];
+        /* 2.16 groups of 4 rounds, w[] keeps the last 4 message groups */
+        for (int g = 0; g < 16; ++g) {
+            if (g < 4)
+                w[g] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + g * 16)), mask);
+            __m128i msg = _mm_add_epi32(w[g & 3], _mm_load_si128((const __m128i*)&SHA256_K[g * 4]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            if (g >= 3 && g <= 14) {
+                tmp = _mm_alignr_epi8(w[g & 3], w[(g + 3) & 3], 4);
+                w[(g + 1) & 3] = _mm_sha256msg2_epu32(_mm_add_epi32(w[(g + 1) & 3], tmp), w[g & 3]);
+            }
+            msg = _mm_shuffle_epi32(msg, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+            if (g >= 1 && g <= 12)
+                w[(g + 3) & 3] = _mm_sha256msg1_epu32(w[(g + 3) & 3], w[g & 3]);
+        }
+        state0 = _mm_add_epi32(state0, abefSave);
+        state1 = _mm_add_epi32(state1, cdghSave);
+    }
+
+    /* 3.back to ABCD/EFGH */
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+    _mm_storeu_si128((__m128i*)&state[0], state0);
+    _mm_storeu_si128((__m128i*)&state[4], state1);
+}
+
+__attribute__((target("sha,sse4.1"))) inline void sha1SHANI(uint32_t* state, const uint8_t* data, size_t blocks) {
+    const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)state), 0x1B);
+    __m128i e0 = _mm_set_epi32((int)state[4], 0, 0, 0), e1;
+
+    for (; blocks > 0; --blocks, data += 64) {
+        __m128i abcdSave = abcd, e0Save = e0;
+        __m128i w[4];
+        /* 20 groups of 4 rounds, e0/e1 take turns as the E input */
+        for (int g = 0; g < 20; ++g) {
+            if (g < 4)
+                w[g] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + g * 16)), mask);
+            __m128i& e = g & 1 ? e1 : e0;
+            __m128i& next = g & 1 ? e0 : e1;
+            e = g == 0 ? _mm_add_epi32(e0, w[0]) : _mm_sha1nexte_epu32(e, w[g & 3]);
+            next = abcd;
+            if (g >= 3 && g <= 18)
+                w[(g + 1) & 3] = _mm_sha1msg2_epu32(w[(g + 1) & 3], w[g & 3]);
+            switch (g / 5) {
+            case 0: abcd = _mm_sha1rnds4_epu32(abcd, e, 0); break;
+            case 1: abcd = _mm_sha1rnds4_epu32(abcd, e, 1); break;
+            case 2: abcd = _mm_sha1rnds4_epu32(abcd, e, 2); break;
+            default: abcd = _mm_sha1rnds4_epu32(abcd, e, 3); break;
+            }
+            if (g >= 1 && g <= 16)
+                w[(g + 3) & 3] = _mm_sha1msg1_epu32(w[(g + 3) & 3], w[g & 3]);
+            if (g >= 2 && g <= 17)
+                w[(g + 2) & 3] = _mm_xor_si128(w[(g + 2) & 3], w[g & 3]);
+        }
+        e0 = _mm_sha1nexte_epu32(e0, e0Save);
+        abcd = _mm_add_epi32(abcd, abcdSave);
+    }
+
+    _mm_storeu_si128((__m128i*)state, _mm_shuffle_epi32(abcd, 0x1B));
+    state[4] = (uint32_t)_mm_extract_epi32(e0, 3);
+}
+#endif
+
+}
+
+/*
+* Shared Merkle-Damgard framing of SHA-1 and SHA-256: 64-byte blocks, big-endian bit length
+*/
+template<int Words, int Bytes>
+class SHABase : public Digest {
+public:
+    using Digest::update;
+
+    void reset() override {
+        memcpy(state, iv, sizeof(state));
+        count = 0;
+        bufLen = 0;
+    }
+
+    SHABase &update(const void* input, size_t len) override {
+        const uint8_t* data = (const uint8_t*)input;
+        count += len;
+        /* 1.complete the buffered block */
+        if (bufLen > 0) {
+            size_t part = 64 - bufLen < len ? 64 - bufLen : len;
+            memcpy(buffer + bufLen, data, part);
+            bufLen += part;
+            data += part;
+            len -= part;
+            if (bufLen < 64)
+                return *this;
+            compress(state, buffer, 1);
+            bufLen = 0;
+        }
+        /* 2.whole blocks straight from the input, then buffer the rest */
+        compress(state, data, len / 64);
+        data += len / 64 * 64;
+        bufLen = len % 64;
+        memcpy(buffer, data, bufLen);
+        return *this;
+    }
+
+    vector<uint8_t> finalize() override {
+        /* pad a copy so that more input may follow */
+        uint32_t st[Words];
+        memcpy(st, state, sizeof(st));
+        uint8_t tail[128] = { 0 };
+        memcpy(tail, buffer, bufLen);
+        tail[bufLen] = 0x80;
+        size_t tailLen = bufLen < 56 ? 64 : 128;
+        uint64_t bits = count << 3;
+        for (int i = 0; i < 8; ++i)
+            tail[tailLen - 1 - i] = (uint8_t)(bits >> (8 * i));
+        compress(st, tail, tailLen / 64);
+        vector<uint8_t> result(Bytes);
+        for (int i = 0; i < Words; ++i)
+            detail::storeBE32(&result[i * 4], st[i]);
+        return result;
+    }
+
+    size_t size() const override {
+        return Bytes;
+    }
+
+protected:
+    typedef void (*Compress)(uint32_t* state, const uint8_t* data, size_t blocks);
+
+    SHABase(const uint32_t* iv, Compress compress) : iv(iv), compress(compress) {
+        reset();
+    }
+
+private:
+    const uint32_t* iv;
+    Compress compress;
+    uint32_t state[Words];
+    uint64_t count;
+    uint8_t buffer[64];
+    size_t bufLen;
+};
+
+class SHA256 : public SHABase<8, 32> {
+public:
+    SHA256() : SHABase(detail::SHA256_IV, pick()) {}
+
+    /* true if the SHA-NI kernel is in use */
+    static bool accelerated() {
+        return pick() != detail::sha256Scalar;
+    }
+
+private:
+    static Compress pick() {
+#ifdef MESSAGEDIGEST_HAS_SHA_NI
+        static const Compress compress = detail::cpuHasSHA() ? detail::sha256SHANI : detail::sha256Scalar;
+        return compress;
+#else
+        return detail::sha256Scalar;
+#endif
+    }
+};
+
+class SHA1 : public SHABase<5, 20> {
+public:
+    SHA1() : SHABase(detail::SHA1_IV, pick()) {}
+
+    /* true if the SHA-NI kernel is in use */
+    static bool accelerated() {
+        return pick() != detail::sha1Scalar;
+    }
+
+private:
+    static Compress pick() {
+#ifdef MESSAGEDIGEST_HAS_SHA_NI
+        static const Compress compress = detail::cpuHasSHA() ? detail::sha1SHANI : detail::sha1Scalar;
+        return compress;
+#else
+        return detail::sha1Scalar;
+#endif
+    }
+};
+
+}
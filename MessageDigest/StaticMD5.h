@@ -0,0 +1,115 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include "MessageDigest.h"
+
+namespace MessageDigest
+{
+
+/*
+* Compile-time MD5 (C++14 constexpr), shares md5Transform() with the MD5 class
+* so both always agree, e.g.
+*
+*     switch (md5Key(name)) { case md5Key("config.reload"): ... }
+*     static_assert(staticMD5("abc") == staticMD5("abc", 3), "");
+*/
+struct StaticMD5Result {
+    uint8_t bytes[16];
+
+    constexpr uint8_t operator[](size_t i) const {
+        return bytes[i];
+    }
+
+    /* first 8 digest bytes as a big-endian integer, i.e. the first 16 hex chars */
+    constexpr uint64_t high() const {
+        uint64_t v = 0;
+        for (int i = 0; i < 8; ++i)
+            v = (v << 8) | bytes[i];
+        return v;
+    }
+
+    /* last 8 digest bytes as a big-endian integer */
+    constexpr uint64_t low() const {
+        uint64_t v = 0;
+        for (int i = 8; i < 16; ++i)
+            v = (v << 8) | bytes[i];
+        return v;
+    }
+
+    MD5::Result toArray() const {
+        MD5::Result result = {};
+        for (size_t i = 0; i < 16; ++i)
+            result[i] = bytes[i];
+        return result;
+    }
+};
+
+constexpr bool operator==(const StaticMD5Result& lhs, const StaticMD5Result& rhs) {
+    for (int i = 0; i < 16; ++i) {
+        if (lhs.bytes[i] != rhs.bytes[i])
+            return false;
+    }
+    return true;
+}
+constexpr bool operator!=(const StaticMD5Result& lhs, const StaticMD5Result& rhs) {
+    return !(lhs == rhs);
+}
+
+/*
+* @MD5 of len chars, usable in constant expressions.
+*/
+constexpr StaticMD5Result staticMD5(const char* message, size_t len) {
+    uint32_t state[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+    uint32_t x[16] = {};
+    /* the padded message is 0x80, zeros, then the bit count in the last 8 bytes of a block */
+    size_t total = (len + 8) / 64 * 64 + 64;
+    for (size_t block = 0; block < total; block += 64) {
+        for (size_t i = 0; i < 64; ++i) {
+            size_t pos = block + i;
+            uint8_t byte = 0;
+            if (pos < len)
+                byte = (uint8_t)message[pos];
+            else if (pos == len)
+                byte = 0x80;
+            else if (pos >= total - 8)
+                byte = (uint8_t)(((uint64_t)len << 3) >> (8 * (pos - (total - 8))));
+            if (i % 4 == 0)
+                x[i / 4] = 0;
+            x[i / 4] |= (uint32_t)byte << (8 * (i % 4));
+        }
+        md5Transform(state, x);
+    }
+    StaticMD5Result result = {};
+    for (int i = 0; i < 16; ++i)
+        result.bytes[i] = (uint8_t)(state[i / 4] >> (8 * (i % 4)));
+    return result;
+}
+
+/*
+* @MD5 of a string literal, the terminating '\0' is not hashed.
+*/
+template<size_t N>
+constexpr StaticMD5Result staticMD5(const char (&literal)[N]) {
+    return staticMD5(literal, N - 1);
+}
+
+/*
+* @64-bit key from the MD5 of a literal, for switch labels and template arguments.
+*/
+template<size_t N>
+constexpr uint64_t md5Key(const char (&literal)[N]) {
+    return staticMD5(literal, N - 1).high();
+}
+
+/*
+* @Runtime counterpart of md5Key for keys that are only known at run time.
+*/
+inline uint64_t md5Key(const string& message) {
+    MD5::Result bytes = MD5().update(message).digestArray();
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i)
+        v = (v << 8) | bytes[i];
+    return v;
+}
+
+}
@@ -0,0 +1,62 @@
+/*
+* StaticMD5 self-test: RFC 1321 test suite at compile time, then every vector against the runtime MD5.
+*
+* g++ -std=c++14 StaticMD5Test.cpp -o StaticMD5Test && ./StaticMD5Test
+*/
+#include <cstdio>
+#include "StaticMD5.h"
+
+using namespace MessageDigest;
+
+static_assert(staticMD5("").high() == 0xd41d8cd98f00b204ULL && staticMD5("").low() == 0xe9800998ecf8427eULL, "MD5 self-test");
+static_assert(staticMD5("a").high() == 0x0cc175b9c0f1b6a8ULL && staticMD5("a").low() == 0x31c399e269772661ULL, "MD5 self-test");
+static_assert(staticMD5("abc").high() == 0x900150983cd24fb0ULL && staticMD5("abc").low() == 0xd6963f7d28e17f72ULL, "MD5 self-test");
+static_assert(staticMD5("message digest").high() == 0xf96b697d7cb7938dULL && staticMD5("message digest").low() == 0x525a2f31aaf161d0ULL, "MD5 self-test");
+static_assert(staticMD5("abcdefghijklmnopqrstuvwxyz").high() == 0xc3fcd3d76192e400ULL && staticMD5("abcdefghijklmnopqrstuvwxyz").low() == 0x7dfb496cca67e13bULL, "MD5 self-test");
+static_assert(staticMD5("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789").high() == 0xd174ab98d277d9f5ULL &&
+    staticMD5("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789").low() == 0xa5611c2c9f419d9fULL, "MD5 self-test");
+static_assert(staticMD5("12345678901234567890123456789012345678901234567890123456789012345678901234567890").high() == 0x57edf4a22be3c955ULL &&
+    staticMD5("12345678901234567890123456789012345678901234567890123456789012345678901234567890").low() == 0xac49da2e2107b67aULL, "MD5 self-test");
+static_assert(staticMD5("abc") == staticMD5("abc", 3), "MD5 self-test");
+static_assert(md5Key("abc") == 0x900150983cd24fb0ULL, "MD5 self-test");
+
+/* constexpr results forced at compile time, compared against the runtime MD5 below */
+static constexpr StaticMD5Result Vectors[] = {
+    staticMD5(""),
+    staticMD5("a"),
+    staticMD5("abc"),
+    staticMD5("message digest"),
+    staticMD5("abcdefghijklmnopqrstuvwxyz"),
+    staticMD5("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789"),
+    staticMD5("12345678901234567890123456789012345678901234567890123456789012345678901234567890"),
+    /* 55, 56 and 64 bytes straddle the padding boundary */
+    staticMD5("0123456789012345678901234567890123456789012345678901234"),
+    staticMD5("01234567890123456789012345678901234567890123456789012345"),
+    staticMD5("0123456789012345678901234567890123456789012345678901234567890123"),
+};
+
+static const char* Messages[] = {
+    "",
+    "a",
+    "abc",
+    "message digest",
+    "abcdefghijklmnopqrstuvwxyz",
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789",
+    "12345678901234567890123456789012345678901234567890123456789012345678901234567890",
+    "0123456789012345678901234567890123456789012345678901234",
+    "01234567890123456789012345678901234567890123456789012345",
+    "0123456789012345678901234567890123456789012345678901234567890123",
+};
+
+int main() {
+    int failed = 0;
+    for (size_t i = 0; i < sizeof(Messages) / sizeof(Messages[0]); ++i) {
+        MD5::Result expected = MD5().update(Messages[i]).digestArray();
+        if (memcmp(expected.data(), Vectors[i].bytes, 16) != 0 || md5Key(string(Messages[i])) != Vectors[i].high()) {
+            printf("<FAILED> staticMD5(\"%s\")\n", Messages[i]);
+            ++failed;
+        }
+    }
+    printf("%s\n", failed ? "StaticMD5 self-test failed" : "StaticMD5 self-test passed");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include "MessageDigest.h"
+
+namespace MessageDigest
+{
+
+/*
+* XXH64, a non-cryptographic 64-bit hash for checksums and hash tables, several GB/s in plain C++
+* finalize() returns the canonical big-endian form, so toString() matches xxhsum
+*/
+class XXH64 : public Digest {
+public:
+    using Digest::update;
+
+    explicit XXH64(uint64_t seed = 0) : seed(seed) {
+        reset();
+    }
+
+    void reset() override {
+        v[0] = seed + PRIME1 + PRIME2;
+        v[1] = seed + PRIME2;
+        v[2] = seed;
+        v[3] = seed - PRIME1;
+        total = 0;
+        bufLen = 0;
+    }
+
+    XXH64 &update(const void* input, size_t len) override {
+        const uint8_t* data = (const uint8_t*)input;
+        total += len;
+        /* 1.complete the buffered stripe */
+        if (bufLen > 0) {
+            size_t part = 32 - bufLen < len ? 32 - bufLen : len;
+            memcpy(buffer + bufLen, data, part);
+            bufLen += part;
+            data += part;
+            len -= part;
+            if (bufLen < 32)
+                return *this;
+            stripe(buffer);
+            bufLen = 0;
+        }
+        /* 2.32-byte stripes feed 4 independent lanes */
+        for (; len >= 32; len -= 32, data += 32)
+            stripe(data);
+        memcpy(buffer, data, len);
+        bufLen = len;
+        return *this;
+    }
+
+    vector<uint8_t> finalize() override {
+        uint64_t h = value();
+        vector<uint8_t> result(8);
+        for (int i = 0; i < 8; ++i)
+            result[i] = (uint8_t)(h >> (56 - 8 * i));
+        return result;
+    }
+
+    size_t size() const override {
+        return 8;
+    }
+
+    /* the hash as an integer */
+    uint64_t value() const {
+        uint64_t h;
+        if (total >= 32) {
+            h = rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18);
+            for (int i = 0; i < 4; ++i)
+                h = (h ^ round(0, v[i])) * PRIME1 + PRIME4;
+        }
+        else {
+            h = seed + PRIME5;
+        }
+        h += total;
+        /* the tail shorter than a stripe */
+        const uint8_t* p = buffer;
+        size_t len = bufLen;
+        for (; len >= 8; len -= 8, p += 8)
+            h = rotl(h ^ round(0, load64(p)), 27) * PRIME1 + PRIME4;
+        if (len >= 4) {
+            h = rotl(h ^ (uint64_t)load32(p) * PRIME1, 23) * PRIME2 + PRIME3;
+            len -= 4;
+            p += 4;
+        }
+        for (; len > 0; --len, ++p)
+            h = rotl(h ^ *p * PRIME5, 11) * PRIME1;
+        /* avalanche */
+        h ^= h >> 33;
+        h *= PRIME2;
+        h ^= h >> 29;
+        h *= PRIME3;
+        h ^= h >> 32;
+        return h;
+    }
+
+private:
+    static const uint64_t PRIME1 = 0x9e3779b185ebca87ULL;
+    static const uint64_t PRIME2 = 0xc2b2ae3d27d4eb4fULL;
+    static const uint64_t PRIME3 = 0x165667b19e3779f9ULL;
+    static const uint64_t PRIME4 = 0x85ebca77c2b2ae63ULL;
+    static const uint64_t PRIME5 = 0x27d4eb2f165667c5ULL;
+
+    static uint64_t rotl(uint64_t x, int n) {
+        return (x << n) | (x >> (64 - n));
+    }
+    static uint64_t round(uint64_t acc, uint64_t input) {
+        return rotl(acc + input * PRIME2, 31) * PRIME1;
+    }
+    /* XXH64 is defined on little-endian words */
+    static uint64_t load64(const uint8_t* p) {
+        uint64_t v = 0;
+        for (int i = 7; i >= 0; --i)
+            v = (v << 8) | p[i];
+        return v;
+    }
+    static uint32_t load32(const uint8_t* p) {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+    void stripe(const uint8_t* p) {
+        v[0] = round(v[0], load64(p));
+        v[1] = round(v[1], load64(p + 8));
+        v[2] = round(v[2], load64(p + 16));
+        v[3] = round(v[3], load64(p + 24));
+    }
+
+    uint64_t seed;
+    uint64_t v[4];
+    uint64_t total;
+    uint8_t buffer[32];
+    size_t bufLen;
+};
+
+}
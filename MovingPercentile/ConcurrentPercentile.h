@@ -0,0 +1,119 @@
+/*
+ *  ConcurrentPercentile.h
+ *
+ *  Created on : Oct 17, 2026
+ *  Single writer, many readers: the writer thread owns the window and publishes the percentile,
+ *  the size and the heap tops through a seqlock after every update or batch
+ *  Readers never take a lock and never block the writer, they only retry if they race a publish
+ */
+
+#pragma once
+#include <atomic>
+#include <utility>
+#include "MovingPercentile.h"
+
+template<typename ValType, typename Window = MovingPercentile<ValType>>
+class ConcurrentMovingPercentile {
+public:
+    struct Snapshot {
+        ValType val;
+        int size;
+        //heap tops are published for heap engines, other engines report the empty-window value
+        ValType minHeapTop, maxHeapTop;
+    };
+
+    //args are forwarded to the underlying window, e.g. (nullVal, med, per)
+    template<typename... Args>
+    explicit ConcurrentMovingPercentile(Args&&... args) : window_(std::forward<Args>(args)...), seq_(0) {
+        ValType empty = window_.getVal();
+        val_.store(empty, std::memory_order_relaxed);
+        minHeapTop_.store(empty, std::memory_order_relaxed);
+        maxHeapTop_.store(empty, std::memory_order_relaxed);
+        size_.store(0, std::memory_order_relaxed);
+    }
+
+    //writer side, call from one thread only
+    void clear() {
+        window_.clear();
+        publish();
+    }
+    void remove() {
+        window_.remove();
+        publish();
+    }
+    void remove(int nums) {
+        window_.remove(nums);
+        publish();
+    }
+    void insert(ValType val) {
+        window_.insert(val);
+        publish();
+    }
+    void insert(const ValType *vals, int len) {
+        window_.insert(vals, len);
+        publish();
+    }
+    void insertAndRemove(ValType val) {
+        window_.insertAndRemove(val);
+        publish();
+    }
+    void insertAndRemove(const ValType *vals, int len) {
+        window_.insertAndRemove(vals, len);
+        publish();
+    }
+    const Window &window() const { return window_; }
+
+    //reader side, safe from any thread
+    Snapshot snapshot() const;
+    ValType getVal() const { return snapshot().val; }
+    int size() const { return snapshot().size; }
+private:
+    template<typename W>
+    auto loadHeapTops(const W &w, ValType &minTop, ValType &maxTop, int) -> decltype(w.minHeapTop(), void()) {
+        minTop = w.minHeapTop();
+        maxTop = w.maxHeapTop();
+    }
+    template<typename W>
+    void loadHeapTops(const W &, ValType &, ValType &, long) {}
+    void publish();
+
+    Window window_;
+    //published state on its own cache line, away from the writer's window data
+    alignas(64) std::atomic<unsigned> seq_;
+    std::atomic<ValType> val_, minHeapTop_, maxHeapTop_;
+    std::atomic<int> size_;
+};
+
+template<typename ValType, typename Window>
+void ConcurrentMovingPercentile<ValType, Window>::publish() {
+    ValType minTop = minHeapTop_.load(std::memory_order_relaxed);
+    ValType maxTop = maxHeapTop_.load(std::memory_order_relaxed);
+    loadHeapTops(window_, minTop, maxTop, 0);
+    //1.odd sequence marks a publish in progress
+    unsigned seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    //2.write the fields, relaxed stores are ordered by the fences
+    val_.store(window_.getVal(), std::memory_order_relaxed);
+    size_.store(window_.size(), std::memory_order_relaxed);
+    minHeapTop_.store(minTop, std::memory_order_relaxed);
+    maxHeapTop_.store(maxTop, std::memory_order_relaxed);
+    //3.even sequence releases the new snapshot
+    seq_.store(seq + 2, std::memory_order_release);
+}
+
+template<typename ValType, typename Window>
+typename ConcurrentMovingPercentile<ValType, Window>::Snapshot ConcurrentMovingPercentile<ValType, Window>::snapshot() const {
+    Snapshot snap;
+    unsigned before, after;
+    do {
+        before = seq_.load(std::memory_order_acquire);
+        snap.val = val_.load(std::memory_order_relaxed);
+        snap.size = size_.load(std::memory_order_relaxed);
+        snap.minHeapTop = minHeapTop_.load(std::memory_order_relaxed);
+        snap.maxHeapTop = maxHeapTop_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = seq_.load(std::memory_order_relaxed);
+    } while (before != after || (before & 1));
+    return snap;
+}
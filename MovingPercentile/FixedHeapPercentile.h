@@ -0,0 +1,369 @@
+/*
+ *  FixedHeapPercentile.h
+ *
+ *  Created on : Oct 17, 2026
+ *  MovingPercentile<ValType, FixedHeap<N, Med>, Policy> is the dual heap engine with a compile-time capacity
+ *  Storage is inline, the circular queue uses power-of-two masking instead of modulo,
+ *  there is no reallocation path and median/percentile is selected at compile time
+ *  Inserting into a full window evicts the oldest item
+ */
+
+#pragma once
+#include <array>
+#include <type_traits>
+#include <cassert>
+#include "MovingPercentile.h"
+
+template<typename ValType, int N, bool Med, typename Policy>
+class MovingPercentile<ValType, FixedHeap<N, Med>, Policy> {
+    static_assert(N > 0, "<FAILED> FixedHeap capacity should be positive");
+    static constexpr int ceilPow2(int n, int p = 1) { return p >= n ? p : ceilPow2(n, p * 2); }
+    //one spare slot keeps curr_ and prev_ apart when the window is full
+    static constexpr int Cap = ceilPow2(N + 1);
+    static constexpr unsigned Mask = Cap - 1;
+public:
+    explicit MovingPercentile(ValType nullVal, double per = 50.0);
+    //same arguments as the other engines (e.g. for rollingPercentile), med must match Med and initBufSize must fit in N,
+    //otherwise the window would silently be a different one
+    MovingPercentile(ValType nullVal, bool med, double per, int initBufSize = N) : MovingPercentile(nullVal, per) {
+        assert(med == Med && "<FAILED> FixedHeap selects median/percentile by Med");
+        assert(initBufSize <= N && "<FAILED> FixedHeap window does not fit in N");
+    }
+    //(nullVal, med) would bind to (nullVal, per), select the median by Med instead
+    template<typename B, typename = typename std::enable_if<std::is_same<B, bool>::value>::type>
+    MovingPercentile(ValType nullVal, B med) = delete;
+    void clear() {
+        curr_ = 0;
+        prev_ = 0;
+        minHeapIdx_ = 1;
+        maxHeapIdx_ = 1;
+        nullCnt_ = 0;
+    }
+    ValType getVal() const { return getValImpl(static_cast<Policy *>(nullptr)); }
+    void remove();
+    void remove(int nums);
+    void insert(ValType val);
+    void insert(const ValType *vals, int len);
+    void insertAndRemove(ValType val);
+    void insertAndRemove(const ValType *vals, int len);
+    int size() const { return static_cast<int>(curr_ - prev_); }
+    static constexpr int capacity() { return N; }
+
+    int minHeapSize() const { return minHeapIdx_ - 1; }
+    int maxHeapSize() const { return maxHeapIdx_ - 1; }
+    ValType minHeapTop() const { return minHeapIdx_ > 1 ? data_[minHeap_[1]] : nullVal_; }
+    ValType maxHeapTop() const { return maxHeapIdx_ > 1 ? data_[maxHeap_[1]] : nullVal_; }
+#ifdef MOVING_PERCENTILE_STATS
+    //doublings stay 0, the capacity is fixed
+    const MovingPercentileStats &stats() const { return stats_; }
+    void resetStats() { stats_ = MovingPercentileStats(); }
+#endif
+private:
+    //Med only applies to DefaultPercentile
+    static constexpr bool DefaultMed = Med && std::is_same<Policy, DefaultPercentile>::value;
+    int targetMinSize(int n) const { return DefaultMed ? n / 2 + 1 : n - Policy::lowerCount(n, per_) + 1; }
+    ValType getValImpl(DefaultPercentile *) const;
+    template<typename P>
+    ValType getValImpl(P *) const {
+        if (maxHeapIdx_ - nullCnt_ == 1)
+            return nullVal_;
+        const ValType &lo = data_[maxHeap_[1]];
+        const ValType &hi = minHeapIdx_ > 1 ? data_[minHeap_[1]] : lo;
+        return P::value(lo, hi, maxHeapIdx_ - nullCnt_ + minHeapIdx_ - 2, per_);
+    }
+    void min2max();
+    void max2min();
+    bool swapImpl(int *heap_, int i, int j);
+    bool mmCmpExch(int *heap_, int i, int j);
+    void minSortDown(int i);
+    void maxSortDown(int i);
+    void minSortUp(int i);
+    void maxSortUp(int i);
+
+    ValType nullVal_;
+    std::array<ValType, Cap> data_;
+    std::array<int, Cap> pos_;
+    //heaps are 1-based, slot 0 holds the sign used in pos_, one extra slot for in-place replacement
+    std::array<int, N + 2> minHeap_, maxHeap_;
+    int minHeapIdx_, maxHeapIdx_;
+    //free-running counters, masked on access
+    unsigned curr_, prev_;
+    int nullCnt_;
+    double per_;
+#ifdef MOVING_PERCENTILE_STATS
+    MovingPercentileStats stats_ = MovingPercentileStats();
+#endif
+};
+
+template<typename ValType, int N, bool Med, typename Policy>
+MovingPercentile<ValType, FixedHeap<N, Med>, Policy>::MovingPercentile(ValType nullVal, double per)
+    : nullVal_(nullVal), per_(DefaultMed ? 50.0 : per) {
+    minHeap_[0] = -1;
+    maxHeap_[0] = 1;
+    clear();
+}
+
+template<typename ValType, int N, bool Med, typename Policy>
+ValType MovingPercentile<ValType, FixedHeap<N, Med>, Policy>::getValImpl(DefaultPercentile *) const {
+    //1.return the top element of the maxHeap (or the average of the two top elements for median)
+    if (maxHeapIdx_ - nullCnt_ == 1)
+        return nullVal_;
+    if (Med && maxHeapIdx_ - nullCnt_ == minHeapIdx_)
+        return (data_[maxHeap_[1]] + data_[minHeap_[1]]) / 2.0;
+    return data_[maxHeap_[1]];
+}
+
+template<typename ValType, int N, bool Med, typename Policy>
+void MovingPercentile<ValType, FixedHeap<N, Med>, Policy>::remove() {
+    if (prev_ == curr_)
+        return;
+    //1.swap the oldest item with the end item in the corresponding heap
+    //2.pop_back to remove the item
+    //3.percolate down from the origin position of the removed item in the corresponding heap
+    unsigned slot = prev_ & Mask;
+    int tmpPos = pos_[slot];
+    if (tmpPos < 0) {
+        swapImpl(minHeap_.data(), -tmpPos, minHeapIdx_ - 1);
+        minSortUp(-tmpPos);
+        minHeapIdx_--;
+        minSortDown(-tmpPos * 2);
+        //4.rebalance the minHeap and the maxHeap
+        if (minHeapIdx_ < targetMinSize(size() - nullCnt_ - 1))
+            max2min();
+    }
+    else {
+        //handle NULL value
+        if (data_[slot] == nullVal_)
+            nullCnt_--;
+        swapImpl(maxHeap_.data(), tmpPos, maxHeapIdx_ - 1);
+        maxSortUp(tmpPos);
+        maxHeapIdx_--;
+        maxSortDown(tmpPos * 2);
+        //4.rebalance the minHeap and the maxHeap
+        if (targetMinSize(size() - nullCnt_ - 1) < minHeapIdx_)
+            min2max();
+    }
+    prev_++;
+}
+
+template<typename ValType, int N, bool Med, typename Policy>
+void MovingPercentile<ValType, FixedHeap<N, Med>, Policy>::remove(int nums) {
+    if (nums >= size()) {
+        clear();
+        return;
+    }
+    for (int i = 0; i < nums; ++i)
+        remove();
+}
+
+template<typename ValType, int N, bool Med, typename Policy>
+void MovingPercentile<ValType, FixedHeap<N, Med>, Policy>::insert(ValType val) {
+    //1.a full window slides instead of growing
+    if (size() == N) {
+        insertAndRemove(val);
+        return;
+    }
+
+    //2.push back val to data_
+    unsigned slot = curr_ & Mask;
+    data_[slot] = val;
+    if (val == nullVal_) {
+        nullCnt_++;
+        MOVING_PERCENTILE_STAT(nullHits++);
+    }
+
+    //3.insert val to the right heap(keep balancing of the two heaps) and percolate up
+    if (targetMinSize(size() - nullCnt_ + 1) == minHeapIdx_) {
+        if (minHeapIdx_ == 1 || val <= data_[minHeap_[1]]) {
+            pos_[slot] = maxHeapIdx_;
+            maxHeap_[maxHeapIdx_++] = slot;
+            maxSortUp(maxHeapIdx_ - 1);
+        }
+        else {
+            min2max();
+            pos_[slot] = -minHeapIdx_;
+            minHeap_[minHeapIdx_++] = slot;
+            minSortUp(minHeapIdx_ - 1);
+        }
+    }
+    else {
+        if (maxHeapIdx_ == 1 || val >= data_[maxHeap_[1]]) {
+            pos_[slot] = -minHeapIdx_;
+            minHeap_[minHeapIdx_++] = slot;
+            minSortUp(minHeapIdx_ - 1);
+        }
+        else {
+            max2min();
+            pos_[slot] = maxHeapIdx_;
+            maxHeap_[maxHeapIdx_++] = slot;
+            maxSortUp(maxHeapIdx_ - 1);
+        }
+    }
+    curr_++;
+}
+
+template<typename ValType, int N, bool Med, typename Policy>
+void MovingPercentile<ValType, FixedHeap<N, Med>, Policy>::insert(const ValType *vals, int len) {
+    for (int i = 0; i < len; ++i)
+        insert(vals[i]);
+}
+
+template<typename ValType, int N, bool Med, typename Policy>
+void MovingPercentile<ValType, FixedHeap<N, Med>, Policy>::insertAndRemove(ValType val) {
+    if (prev_ == curr_)
+        return;
+    unsigned slot = curr_ & Mask, oldSlot = prev_ & Mask;
+    int tmpPos = pos_[oldSlot];
+    if ((tmpPos > 0 && data_[oldSlot] == nullVal_) || val == nullVal_) {
+        remove();
+        insert(val);
+        return;
+    }
+    data_[slot] = val;
+
+    //1.remove the oldest value from the corresponding heap
+    if (tmpPos < 0) {
+        //2.remove from minHeap, insert to minHeap
+        if (maxHeapIdx_ == 1 || val > data_[maxHeap_[1]]) {
+            pos_[slot] = -minHeapIdx_;
+            minHeap_[minHeapIdx_++] = slot;
+            swapImpl(minHeap_.data(), -tmpPos, minHeapIdx_ - 1);
+            minHeapIdx_--;
+            if (data_[oldSlot] < val)
+                minSortDown(-tmpPos * 2);
+            else
+                minSortUp(-tmpPos);
+        }
+        //2.remove from minHeap, insert to maxHeap
+        else {
+            pos_[maxHeap_[1]] = -minHeapIdx_;
+            minHeap_[minHeapIdx_++] = maxHeap_[1];
+            swapImpl(minHeap_.data(), -tmpPos, minHeapIdx_ - 1);
+            minHeapIdx_--;
+            minSortUp(-tmpPos);
+            maxHeap_[1] = slot;
+            pos_[slot] = 1;
+            maxSortDown(1);
+        }
+    }
+    else {
+        //2.remove from maxHeap, insert to maxHeap
+        if (minHeapIdx_ == 1 || val <= data_[minHeap_[1]]) {
+            pos_[slot] = maxHeapIdx_;
+            maxHeap_[maxHeapIdx_++] = slot;
+            swapImpl(maxHeap_.data(), tmpPos, maxHeapIdx_ - 1);
+            maxHeapIdx_--;
+            if (data_[oldSlot] > val)
+                maxSortDown(tmpPos * 2);
+            else
+                maxSortUp(tmpPos);
+        }
+        //2.remove from maxHeap, insert to minHeap
+        else {
+            pos_[minHeap_[1]] = maxHeapIdx_;
+            maxHeap_[maxHeapIdx_++] = minHeap_[1];
+            swapImpl(maxHeap_.data(), tmpPos, maxHeapIdx_ - 1);
+            maxHeapIdx_--;
+            maxSortUp(tmpPos);
+            minHeap_[1] = slot;
+            pos_[slot] = -1;
+            minSortDown(1);
+        }
+    }
+    prev_++;
+    curr_++;
+}
+
+template<typename ValType, int N, bool Med, typename Policy>
+void MovingPercentile<ValType, FixedHeap<N, Med>, Policy>::insertAndRemove(const ValType *vals, int len) {
+    for (int i = 0; i < len; ++i)
+        insertAndRemove(vals[i]);
+}
+
+//insert maximum/minimum value from minHeap/maxHeap to the other heap (source heap remains intact)
+template<typename ValType, int N, bool Med, typename Policy>
+void MovingPercentile<ValType, FixedHeap<N, Med>, Policy>::min2max() {
+    MOVING_PERCENTILE_STAT(rebalances++);
+    swapImpl(minHeap_.data(), 1, minHeapIdx_ - 1);
+    pos_[minHeap_[minHeapIdx_ - 1]] = maxHeapIdx_;
+    maxHeap_[maxHeapIdx_++] = minHeap_[minHeapIdx_ - 1];
+    maxSortUp(maxHeapIdx_ - 1);
+    minHeapIdx_--;
+    minSortDown(1);
+}
+
+template<typename ValType, int N, bool Med, typename Policy>
+void MovingPercentile<ValType, FixedHeap<N, Med>, Policy>::max2min() {
+    MOVING_PERCENTILE_STAT(rebalances++);
+    swapImpl(maxHeap_.data(), 1, maxHeapIdx_ - 1);
+    pos_[maxHeap_[maxHeapIdx_ - 1]] = minHeapIdx_ * -1;
+    minHeap_[minHeapIdx_++] = maxHeap_[maxHeapIdx_ - 1];
+    minSortUp(minHeapIdx_ - 1);
+    maxHeapIdx_--;
+    maxSortDown(1);
+}
+
+//swaps items i & j in heap, maintains indices
+template<typename ValType, int N, bool Med, typename Policy>
+bool MovingPercentile<ValType, FixedHeap<N, Med>, Policy>::swapImpl(int *heap_, int i, int j) {
+    int t = heap_[i];
+    heap_[i] = heap_[j];
+    heap_[j] = t;
+    pos_[heap_[i]] = heap_[0] * i;
+    pos_[heap_[j]] = heap_[0] * j;
+    return true;
+}
+
+//swaps items i & j if i < j, returns true if swapped
+template<typename ValType, int N, bool Med, typename Policy>
+bool MovingPercentile<ValType, FixedHeap<N, Med>, Policy>::mmCmpExch(int *heap_, int i, int j) {
+    return data_[heap_[i]] < data_[heap_[j]] && swapImpl(heap_, i, j);
+}
+
+//maintains min heap property for all items below i/2
+template<typename ValType, int N, bool Med, typename Policy>
+void MovingPercentile<ValType, FixedHeap<N, Med>, Policy>::minSortDown(int i) {
+    MOVING_PERCENTILE_STAT(siftDowns++);
+    int minHeapCount = minHeapIdx_ - 1;
+    for (; i <= minHeapCount; i *= 2) {
+        if (i > 1 && i < minHeapCount && data_[minHeap_[i + 1]] < data_[minHeap_[i]])
+            ++i;
+        if (i > 1 && !mmCmpExch(minHeap_.data(), i, i / 2))
+            break;
+        MOVING_PERCENTILE_STAT(siftDownSteps += i > 1);
+    }
+}
+
+//maintains max heap property for all items below i/2
+template<typename ValType, int N, bool Med, typename Policy>
+void MovingPercentile<ValType, FixedHeap<N, Med>, Policy>::maxSortDown(int i) {
+    MOVING_PERCENTILE_STAT(siftDowns++);
+    int maxHeapCount = maxHeapIdx_ - 1;
+    for (; i <= maxHeapCount; i *= 2) {
+        if (i > 1 && i < maxHeapCount && data_[maxHeap_[i]] < data_[maxHeap_[i + 1]])
+            ++i;
+        if (i > 1 && !mmCmpExch(maxHeap_.data(), i / 2, i))
+            break;
+        MOVING_PERCENTILE_STAT(siftDownSteps += i > 1);
+    }
+}
+
+//maintains min heap property for all items above i
+template<typename ValType, int N, bool Med, typename Policy>
+void MovingPercentile<ValType, FixedHeap<N, Med>, Policy>::minSortUp(int i) {
+    MOVING_PERCENTILE_STAT(siftUps++);
+    while (i > 1 && mmCmpExch(minHeap_.data(), i, i / 2)) {
+        i /= 2;
+        MOVING_PERCENTILE_STAT(siftUpSteps++);
+    }
+}
+
+//maintains max heap property for all items above i
+template<typename ValType, int N, bool Med, typename Policy>
+void MovingPercentile<ValType, FixedHeap<N, Med>, Policy>::maxSortUp(int i) {
+    MOVING_PERCENTILE_STAT(siftUps++);
+    while (i > 1 && mmCmpExch(maxHeap_.data(), i / 2, i)) {
+        i /= 2;
+        MOVING_PERCENTILE_STAT(siftUpSteps++);
+    }
+}
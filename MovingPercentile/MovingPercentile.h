@@ -7,20 +7,108 @@
  */
 
 #pragma once
-template<typename ValType>
+#include <type_traits>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <cstddef>
+
+//define MOVING_PERCENTILE_STATS before including to count hot-path events per instance, read them with stats()
+//without it the counters and stats() do not exist and the hooks compile to nothing
+struct MovingPercentileStats {
+    //sift calls and the levels they actually moved, steps / calls is the average depth
+    unsigned long long siftUps, siftUpSteps, siftDowns, siftDownSteps;
+    //items moved between the two heaps, buffer doublings and null values inserted
+    unsigned long long rebalances, doublings, nullHits;
+};
+#ifdef MOVING_PERCENTILE_STATS
+#define MOVING_PERCENTILE_STAT(expr) (stats_.expr)
+#else
+#define MOVING_PERCENTILE_STAT(expr) ((void)0)
+#endif
+
+//engine tags, SortedBlock lives in SortedBlockPercentile.h, FixedHeap in FixedHeapPercentile.h
+//and Histogram in HistogramPercentile.h
+struct DualHeap {};
+struct SortedBlock {};
+template<int N, bool Med = false>
+struct FixedHeap {};
+template<int SubBits = 0>
+struct Histogram {};
+
+//percentile definitions, selected at compile time by the Policy template parameter
+//the window is split so the lower part holds lowerCount(n, per) items, value() combines the
+//largest lower item and the smallest upper item, which are the two heap tops
+//DefaultPercentile keeps the original definitions selected by the med constructor flag
+struct DefaultPercentile {
+    static int lowerCount(int n, double per) { return n - static_cast<int>(n * (100.0 - per) / 100.0); }
+};
+
+//numpy.percentile/Excel PERCENTILE.INC style definitions on the position h = (n - 1) * (per / 100),
+//per / 100 is rounded first like numpy so the split matches it bit for bit
+struct NumpyPercentile {
+    static int lowerCount(int n, double per) { return n > 0 ? static_cast<int>((n - 1) * (per / 100.0)) + 1 : 0; }
+    static double fraction(int n, double per) {
+        double h = (n - 1) * (per / 100.0);
+        return h - std::floor(h);
+    }
+};
+struct LinearPercentile : NumpyPercentile {
+    template<typename ValType>
+    static ValType value(const ValType &lo, const ValType &hi, int n, double per) {
+        //same lerp as numpy, exact at both ends
+        double t = fraction(n, per);
+        return t >= 0.5 ? hi - (hi - lo) * (1.0 - t) : lo + (hi - lo) * t;
+    }
+};
+struct LowerPercentile : NumpyPercentile {
+    template<typename ValType>
+    static ValType value(const ValType &lo, const ValType &, int, double) { return lo; }
+};
+struct HigherPercentile : NumpyPercentile {
+    template<typename ValType>
+    static ValType value(const ValType &lo, const ValType &hi, int n, double per) { return fraction(n, per) > 0.0 ? hi : lo; }
+};
+struct NearestPercentile : NumpyPercentile {
+    template<typename ValType>
+    static ValType value(const ValType &lo, const ValType &hi, int n, double per) {
+        //ties round half to even like numpy.around
+        double t = fraction(n, per);
+        if (t == 0.5)
+            return (lowerCount(n, per) - 1) % 2 == 0 ? lo : hi;
+        return t < 0.5 ? lo : hi;
+    }
+};
+struct MidpointPercentile : NumpyPercentile {
+    template<typename ValType>
+    static ValType value(const ValType &lo, const ValType &hi, int n, double per) { return fraction(n, per) > 0.0 ? (lo + hi) / 2.0 : lo; }
+};
+
+//Alloc (e.g. an arena or a std::pmr::polymorphic_allocator) only applies to the DualHeap engine
+template<typename ValType, typename Engine = DualHeap, typename Policy = DefaultPercentile, typename Alloc = std::allocator<ValType>>
 class MovingPercentile {
+    static_assert(std::is_same<Engine, DualHeap>::value, "<FAILED> include the header of the selected engine, custom allocators need DualHeap");
+    static_assert(alignof(ValType) <= alignof(std::max_align_t), "<FAILED> over-aligned ValType is not supported");
 public:
-    explicit MovingPercentile(ValType nullVal, bool med = false, double per = 50.0, int initBufSize = 1024);
+    //med only applies to DefaultPercentile
+    explicit MovingPercentile(ValType nullVal, bool med = false, double per = 50.0, int initBufSize = 1024, const Alloc &alloc = Alloc());
     ~MovingPercentile();
+    MovingPercentile(const MovingPercentile &) = delete;
+    MovingPercentile &operator=(const MovingPercentile &) = delete;
     void clear() {
         curr_ = 0;
         prev_ = 0;
         minHeapIdx_ = 0;
         maxHeapIdx_ = 0;
+        nullCnt_ = 0;
         minHeap_[minHeapIdx_++] = -1;
         maxHeap_[maxHeapIdx_++] = 1;
     }
-    ValType getVal() const { return (this->*getVal_)(); }
+    ValType getVal() const { return getValImpl(static_cast<Policy *>(nullptr)); }
     void remove();
     void remove(int nums);
     void insert(ValType val);
@@ -29,13 +117,46 @@ public:
     void insertAndRemove(const ValType *vals, int len);
     int size() const { return (curr_ - prev_ + bufferSize_) % bufferSize_; }
 
+    //replaces the window by vals (oldest first) in O(len): partition around the target rank, then heapify both halves
+    void assign(const ValType *vals, int len);
+    //binary image of the internal arrays, restore() only accepts images from the same ValType and platform
+    size_t snapshotSize() const;
+    void snapshot(char *out) const;
+    std::vector<char> snapshot() const;
+    bool restore(const char *in, size_t len);
+    bool restore(const std::vector<char> &image) { return restore(image.data(), image.size()); }
+
     int minHeapSize() const { return minHeapIdx_ - 1; }
     int maxHeapSize() const { return maxHeapIdx_ - 1; }
-    ValType minHeapTop() const { return minHeapIdx_ > 1 ? minHeap_[1] : nullVal_; }
-    ValType maxHeapTop() const { return maxHeapIdx_ > 1 ? maxHeap_[1] : nullVal_; }
+    ValType minHeapTop() const { return minHeapIdx_ > 1 ? data_[minHeap_[1]] : nullVal_; }
+    ValType maxHeapTop() const { return maxHeapIdx_ > 1 ? data_[maxHeap_[1]] : nullVal_; }
+#ifdef MOVING_PERCENTILE_STATS
+    const MovingPercentileStats &stats() const { return stats_; }
+    void resetStats() { stats_ = MovingPercentileStats(); }
+#endif
 private:
+    //minHeapIdx_ once n non-null items are split by the policy
+    int targetMinSize(int n) const { return n - Policy::lowerCount(n, per_) + 1; }
+    ValType getValImpl(DefaultPercentile *) const { return (this->*getVal_)(); }
+    template<typename P>
+    ValType getValImpl(P *) const;
     ValType getMedVal() const;
     ValType getPerVal() const;
+    //pos_, minHeap_, maxHeap_ and data_ share one block from the allocator, in this order
+    using BlockAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<std::max_align_t>;
+    static size_t dataOffset(int bufferSize) {
+        size_t offset = 3 * static_cast<size_t>(bufferSize) * sizeof(int);
+        return (offset + alignof(ValType) - 1) / alignof(ValType) * alignof(ValType);
+    }
+    static size_t blockUnits(int bufferSize) {
+        return (dataOffset(bufferSize) + bufferSize * sizeof(ValType) + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t);
+    }
+    void allocate(int bufferSize);
+    void deallocate();
+    void reallocate(int bufferSize);
+    void grow();
+    //rebuilds both heaps and pos_ over data_[0, len) in O(len), the heaps must be cleared
+    void rebuild(int len);
     void min2max();
     void max2min();
     bool swapImpl(int *heap_, int i, int j);
@@ -52,16 +173,18 @@ private:
     int bufferSize_;
     int curr_, prev_, nullCnt_;
     double per_;
-    ValType(MovingPercentile::*getVal_)();
+    ValType(MovingPercentile::*getVal_)() const;
+    BlockAlloc alloc_;
+    std::max_align_t *block_;
+#ifdef MOVING_PERCENTILE_STATS
+    MovingPercentileStats stats_ = MovingPercentileStats();
+#endif
 };
 
-template<typename ValType>
-MovingPercentile<ValType>::MovingPercentile(ValType nullVal, bool med, double per, int initBufSize)
-    : nullVal_(nullVal), minHeapIdx_(0), maxHeapIdx_(0), bufferSize_(initBufSize), curr_(0), prev_(0), nullCnt_(0), per_(per) {
-    data_ = new ValType[bufferSize_];
-    pos_ = new int[bufferSize_];
-    minHeap_ = new int[bufferSize_];
-    maxHeap_ = new int[bufferSize_];
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+MovingPercentile<ValType, Engine, Policy, Alloc>::MovingPercentile(ValType nullVal, bool med, double per, int initBufSize, const Alloc &alloc)
+    : nullVal_(nullVal), minHeapIdx_(0), maxHeapIdx_(0), bufferSize_(initBufSize), curr_(0), prev_(0), nullCnt_(0), per_(per), alloc_(alloc) {
+    allocate(initBufSize);
     minHeap_[minHeapIdx_++] = -1;
     maxHeap_[maxHeapIdx_++] = 1;
     if (med) {
@@ -73,16 +196,13 @@ MovingPercentile<ValType>::MovingPercentile(ValType nullVal, bool med, double pe
     }
 }
 
-template<typename ValType>
-MovingPercentile<ValType>::~MovingPercentile() {
-    delete[] minHeap_;
-    delete[] maxHeap_;
-    delete[] data_;
-    delete[] pos_;
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+MovingPercentile<ValType, Engine, Policy, Alloc>::~MovingPercentile() {
+    deallocate();
 }
 
-template<typename ValType>
-void MovingPercentile<ValType>::remove() {
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+void MovingPercentile<ValType, Engine, Policy, Alloc>::remove() {
     if (prev_ == curr_)
         return;
     //1.swap the oldest item with the end item in the corresponding heap
@@ -95,8 +215,7 @@ void MovingPercentile<ValType>::remove() {
         minHeapIdx_--;
         minSortDown(-tmpPos * 2);
         //4.rebalance the minHeap and the maxHeap
-        int targetMinSize = (curr_ - prev_ - nullCnt_ - 1 + bufferSize_) % bufferSize_ * (100.0 - per_) / 100.0 + 1;
-        if (minHeapIdx_ < targetMinSize) {
+        if (minHeapIdx_ < targetMinSize(size() - nullCnt_ - 1)) {
             max2min();
         }
     }
@@ -109,63 +228,49 @@ void MovingPercentile<ValType>::remove() {
         maxHeapIdx_--;
         maxSortDown(tmpPos * 2);
         //4.rebalance the minHeap and the maxHeap
-        int targetMinSize = (curr_ - prev_ - nullCnt_ - 1 + bufferSize_) % bufferSize_ * (100.0 - per_) / 100.0 + 1;
-        if (targetMinSize < minHeapIdx_) {
+        if (targetMinSize(size() - nullCnt_ - 1) < minHeapIdx_) {
             min2max();
         }
     }
     prev_ = (prev_ + 1) % bufferSize_;
 }
 
-template<typename ValType>
-void MovingPercentile<ValType>::remove(int nums) {
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+void MovingPercentile<ValType, Engine, Policy, Alloc>::remove(int nums) {
+    //evicting the whole window is a reset, no need to sift item by item
+    if (nums >= size()) {
+        clear();
+        return;
+    }
+    //evicting most of the window is cheaper as a linear rebuild from the survivors, rotated to the front of data_
+    if (nums > size() / 2) {
+        int len = size() - nums;
+        std::rotate(data_, data_ + (prev_ + nums) % bufferSize_, data_ + bufferSize_);
+        clear();
+        rebuild(len);
+        return;
+    }
     for (int i = 0; i < nums; ++i)
         remove();
 }
 
-template<typename ValType>
-void MovingPercentile<ValType>::insert(ValType val) {
-    //1.check circular queue(data_/pos_) capacity, initialize a new data_/pos_ with large buffer size if necessary
-    if (maxHeapIdx_ + minHeapIdx_ == bufferSize_) {
-        int *oldMinHeap_ = minHeap_, *oldMaxHeap_ = maxHeap_;
-        ValType *oldData_ = data_;
-        int *oldPos_ = pos_;
-        minHeap_ = new int[bufferSize_ * 2];
-        minHeap_[0] = -1;
-        maxHeap_ = new int[bufferSize_ * 2];
-        maxHeap_[0] = 1;
-        data_ = new ValType[bufferSize_ * 2];
-        pos_ = new int[bufferSize_ * 2];
-
-        for (int i = 0; i < bufferSize_; ++i) {
-            data_[i] = oldData_[(prev_ + i) % bufferSize_];
-            pos_[i] = oldPos_[(prev_ + i) % bufferSize_];
-        }
-        for (int i = 1; i < minHeapIdx_; ++i) {
-            minHeap_[i] = (oldMinHeap_[i] + bufferSize_ - prev_) % bufferSize_;
-        }
-        for (int i = 1; i < maxHeapIdx_; ++i) {
-            maxHeap_[i] = (oldMaxHeap_[i] + bufferSize_ - prev_) % bufferSize_;
-        }
-        curr_ = (curr_ + bufferSize_ - prev_) % bufferSize_;
-        prev_ = 0;
-        bufferSize_ *= 2;
-        delete[] oldMinHeap_;
-        delete[] oldMaxHeap_;
-        delete[] oldData_;
-        delete[] oldPos_;
-    }
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+void MovingPercentile<ValType, Engine, Policy, Alloc>::insert(ValType val) {
+    //1.check circular queue(data_/pos_) capacity, move to a block twice as large if necessary
+    if (maxHeapIdx_ + minHeapIdx_ == bufferSize_)
+        grow();
 
     //2.push back val to data_
     data_[curr_] = val;
-    if (val == nullVal_)
+    if (val == nullVal_) {
         nullCnt_++;
+        MOVING_PERCENTILE_STAT(nullHits++);
+    }
 
     //3.compare val with the top elements of minHeap and maxHeap
     //4.insert val to the right heap(keep balancing of the two heaps)
     //5.percolate up in the corresponding heap
-    int targetMinSize = (curr_ - prev_ - nullCnt_ + 1 + bufferSize_) % bufferSize_ * (100.0 - per_) / 100.0 + 1;
-    if (targetMinSize == minHeapIdx_) {
+    if (targetMinSize(size() - nullCnt_ + 1) == minHeapIdx_) {
         if (minHeapIdx_ == 1 || val <= data_[minHeap_[1]]) {
             //insert val to maxHeap
             pos_[curr_] = maxHeapIdx_;
@@ -182,7 +287,7 @@ void MovingPercentile<ValType>::insert(ValType val) {
         }
     }
     else {
-        if (val >= data_[maxHeap_[1]]) {
+        if (maxHeapIdx_ == 1 || val >= data_[maxHeap_[1]]) {
             //insert val to minHeap
             pos_[curr_] = -minHeapIdx_;
             minHeap_[minHeapIdx_++] = curr_;
@@ -200,29 +305,29 @@ void MovingPercentile<ValType>::insert(ValType val) {
     curr_ = (curr_ + 1) % bufferSize_;
 }
 
-template<typename ValType>
-void MovingPercentile<ValType>::insert(const ValType *vals, int len) {
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+void MovingPercentile<ValType, Engine, Policy, Alloc>::insert(const ValType *vals, int len) {
     for (int i = 0; i < len; ++i)
         insert(vals[i]);
 }
 
-template<typename ValType>
-void MovingPercentile<ValType>::insertAndRemove(ValType val) {
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+void MovingPercentile<ValType, Engine, Policy, Alloc>::insertAndRemove(ValType val) {
     if (prev_ == curr_)
         return;
     data_[curr_] = val;
 
     int tmpPos = pos_[prev_];
     if (tmpPos > 0 && data_[maxHeap_[tmpPos]] == nullVal_ || val == nullVal_) {
-        MovingPercentile<ValType>::insert(val);
-        MovingPercentile<ValType>::remove();
+        insert(val);
+        remove();
         return;
     }
 
     //1.remove the oldest value from the corresponding heap
     if (tmpPos < 0) {
         //2.remove from minHeap, insert to minHeap
-        if (val > data_[maxHeap_[1]]) {
+        if (maxHeapIdx_ == 1 || val > data_[maxHeap_[1]]) {
             pos_[curr_] = -minHeapIdx_;
             minHeap_[minHeapIdx_++] = curr_;
             swapImpl(minHeap_, -tmpPos, minHeapIdx_ - 1);
@@ -246,7 +351,7 @@ void MovingPercentile<ValType>::insertAndRemove(ValType val) {
     }
     else {
         //2.remove from maxHeap, insert to maxHeap
-        if (val <= data_[minHeap_[1]]) {
+        if (minHeapIdx_ == 1 || val <= data_[minHeap_[1]]) {
             pos_[curr_] = maxHeapIdx_;
             maxHeap_[maxHeapIdx_++] = curr_;
             swapImpl(maxHeap_, tmpPos, maxHeapIdx_ - 1);
@@ -272,14 +377,238 @@ void MovingPercentile<ValType>::insertAndRemove(ValType val) {
     curr_ = (curr_ + 1) % bufferSize_;
 }
 
-template<typename ValType>
-void MovingPercentile<ValType>::insertAndRemove(const ValType *vals, int len) {
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+void MovingPercentile<ValType, Engine, Policy, Alloc>::insertAndRemove(const ValType *vals, int len) {
     for (int i = 0; i < len; ++i)
         insertAndRemove(vals[i]);
 }
 
-template<typename ValType>
-ValType MovingPercentile<ValType>::getMedVal() const {
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+void MovingPercentile<ValType, Engine, Policy, Alloc>::assign(const ValType *vals, int len) {
+    //1.make room for the whole window (heaps need two extra sentinel slots), old content is dropped
+    clear();
+    if (len + 2 > bufferSize_) {
+        int bufferSize = bufferSize_;
+        while (bufferSize < len + 2)
+            bufferSize *= 2;
+        reallocate(bufferSize);
+    }
+    //2.copy the window to the front of data_ and heapify it there
+    std::copy(vals, vals + len, data_);
+    rebuild(len);
+}
+
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+void MovingPercentile<ValType, Engine, Policy, Alloc>::rebuild(int len) {
+    //1.nulls always stay in the maxHeap, the other slots are gathered in the minHeap array as scratch
+    int *slots = minHeap_ + 1;
+    int count = 0;
+    for (int i = 0; i < len; ++i) {
+        if (data_[i] == nullVal_)
+            maxHeap_[maxHeapIdx_++] = i;
+        else
+            slots[count++] = i;
+    }
+    nullCnt_ = maxHeapIdx_ - 1;
+    //2.the smallest lowerCount items go to the maxHeap, the others slide down to the front of the minHeap
+    int minCount = targetMinSize(count) - 1;
+    int *split = slots + count - minCount;
+    auto less = [this](int a, int b) { return data_[a] < data_[b]; };
+    std::nth_element(slots, split, slots + count, less);
+    maxHeapIdx_ = static_cast<int>(std::copy(slots, split, maxHeap_ + maxHeapIdx_) - maxHeap_);
+    minHeapIdx_ = static_cast<int>(std::copy(split, slots + count, minHeap_ + 1) - minHeap_);
+    //3.heapify both halves, 1-based heaps line up with std heaps shifted by one
+    std::make_heap(maxHeap_ + 1, maxHeap_ + maxHeapIdx_, less);
+    std::make_heap(minHeap_ + 1, minHeap_ + minHeapIdx_, [this](int a, int b) { return data_[b] < data_[a]; });
+    for (int i = 1; i < maxHeapIdx_; ++i)
+        pos_[maxHeap_[i]] = i;
+    for (int i = 1; i < minHeapIdx_; ++i)
+        pos_[minHeap_[i]] = -i;
+    curr_ = len % bufferSize_;
+}
+
+//snapshot layout: header, then data_/pos_ (bufferSize_ each), then both heaps (including slot 0)
+struct MovingPercentileImage {
+    uint32_t magic, version, valSize, med;
+    int32_t bufferSize, curr, prev, minHeapIdx, maxHeapIdx, nullCnt;
+    double per;
+    static const uint32_t Magic = 0x5443504dU;
+    static const uint32_t Version = 1;
+};
+
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+size_t MovingPercentile<ValType, Engine, Policy, Alloc>::snapshotSize() const {
+    return sizeof(MovingPercentileImage) + bufferSize_ * (sizeof(ValType) + sizeof(int)) + (minHeapIdx_ + maxHeapIdx_) * sizeof(int);
+}
+
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+void MovingPercentile<ValType, Engine, Policy, Alloc>::snapshot(char *out) const {
+    static_assert(std::is_trivially_copyable<ValType>::value, "<FAILED> snapshot requires a trivially copyable ValType");
+    MovingPercentileImage image = { MovingPercentileImage::Magic, MovingPercentileImage::Version, sizeof(ValType),
+        getVal_ == &MovingPercentile::getMedVal, bufferSize_, curr_, prev_, minHeapIdx_, maxHeapIdx_, nullCnt_, per_ };
+    memcpy(out, &image, sizeof(image));
+    out += sizeof(image);
+    memcpy(out, data_, bufferSize_ * sizeof(ValType));
+    out += bufferSize_ * sizeof(ValType);
+    memcpy(out, pos_, bufferSize_ * sizeof(int));
+    out += bufferSize_ * sizeof(int);
+    memcpy(out, minHeap_, minHeapIdx_ * sizeof(int));
+    out += minHeapIdx_ * sizeof(int);
+    memcpy(out, maxHeap_, maxHeapIdx_ * sizeof(int));
+}
+
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+std::vector<char> MovingPercentile<ValType, Engine, Policy, Alloc>::snapshot() const {
+    std::vector<char> image(snapshotSize());
+    snapshot(image.data());
+    return image;
+}
+
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+bool MovingPercentile<ValType, Engine, Policy, Alloc>::restore(const char *in, size_t len) {
+    static_assert(std::is_trivially_copyable<ValType>::value, "<FAILED> restore requires a trivially copyable ValType");
+    //1.validate the header before touching any state
+    MovingPercentileImage image;
+    if (len < sizeof(image))
+        return false;
+    memcpy(&image, in, sizeof(image));
+    if (image.magic != MovingPercentileImage::Magic || image.version != MovingPercentileImage::Version || image.valSize != sizeof(ValType))
+        return false;
+    if (image.bufferSize <= 2 || image.curr < 0 || image.curr >= image.bufferSize || image.prev < 0 || image.prev >= image.bufferSize)
+        return false;
+    if (image.minHeapIdx < 1 || image.maxHeapIdx < 1 || image.minHeapIdx + image.maxHeapIdx > image.bufferSize)
+        return false;
+    size_t arrays = image.bufferSize * (sizeof(ValType) + sizeof(int)) + (image.minHeapIdx + image.maxHeapIdx) * sizeof(int);
+    if (len != sizeof(image) + arrays)
+        return false;
+    int count = (image.curr - image.prev + image.bufferSize) % image.bufferSize;
+    if (!(image.per >= 0.0 && image.per <= 100.0) || image.nullCnt < 0 || image.minHeapIdx - 1 + image.maxHeapIdx - 1 != count)
+        return false;
+    int nonNull = count - image.nullCnt;
+    if (nonNull < 0 || image.minHeapIdx != nonNull - Policy::lowerCount(nonNull, image.per) + 1)
+        return false;
+    //2.every heap entry must be a live ring slot whose pos_ points back at it, so both heaps cover the window once,
+    //and the nulls must all sit in the maxHeap
+    const char *data = in + sizeof(image);
+    const char *pos = data + image.bufferSize * sizeof(ValType);
+    const char *minHeap = pos + image.bufferSize * sizeof(int);
+    const char *maxHeap = minHeap + image.minHeapIdx * sizeof(int);
+    auto readInt = [](const char *p, int i) { int v; memcpy(&v, p + i * sizeof(int), sizeof(int)); return v; };
+    if (readInt(minHeap, 0) != -1 || readInt(maxHeap, 0) != 1)
+        return false;
+    int nulls = 0;
+    for (int h = 0; h < 2; ++h) {
+        const char *heap = h ? maxHeap : minHeap;
+        int heapIdx = h ? image.maxHeapIdx : image.minHeapIdx;
+        int sign = h ? 1 : -1;
+        for (int i = 1; i < heapIdx; ++i) {
+            int slot = readInt(heap, i);
+            if (slot < 0 || slot >= image.bufferSize || (slot - image.prev + image.bufferSize) % image.bufferSize >= count)
+                return false;
+            if (readInt(pos, slot) != sign * i)
+                return false;
+            ValType val;
+            memcpy(&val, data + slot * sizeof(ValType), sizeof(ValType));
+            if (val == nullVal_ && (!h || ++nulls > image.nullCnt))
+                return false;
+        }
+    }
+    if (nulls != image.nullCnt)
+        return false;
+    //3.memcpy the arrays back, no heap is rebuilt
+    if (image.bufferSize != bufferSize_)
+        reallocate(image.bufferSize);
+    in += sizeof(image);
+    memcpy(data_, in, bufferSize_ * sizeof(ValType));
+    in += bufferSize_ * sizeof(ValType);
+    memcpy(pos_, in, bufferSize_ * sizeof(int));
+    in += bufferSize_ * sizeof(int);
+    memcpy(minHeap_, in, image.minHeapIdx * sizeof(int));
+    in += image.minHeapIdx * sizeof(int);
+    memcpy(maxHeap_, in, image.maxHeapIdx * sizeof(int));
+    curr_ = image.curr;
+    prev_ = image.prev;
+    minHeapIdx_ = image.minHeapIdx;
+    maxHeapIdx_ = image.maxHeapIdx;
+    nullCnt_ = image.nullCnt;
+    per_ = image.per;
+    getVal_ = image.med ? &MovingPercentile::getMedVal : &MovingPercentile::getPerVal;
+    return true;
+}
+
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+void MovingPercentile<ValType, Engine, Policy, Alloc>::allocate(int bufferSize) {
+    block_ = std::allocator_traits<BlockAlloc>::allocate(alloc_, blockUnits(bufferSize));
+    pos_ = reinterpret_cast<int *>(block_);
+    minHeap_ = pos_ + bufferSize;
+    maxHeap_ = minHeap_ + bufferSize;
+    data_ = reinterpret_cast<ValType *>(reinterpret_cast<char *>(block_) + dataOffset(bufferSize));
+    for (int i = 0; i < bufferSize; ++i)
+        ::new (static_cast<void *>(data_ + i)) ValType;
+    bufferSize_ = bufferSize;
+}
+
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+void MovingPercentile<ValType, Engine, Policy, Alloc>::deallocate() {
+    for (int i = 0; i < bufferSize_; ++i)
+        data_[i].~ValType();
+    std::allocator_traits<BlockAlloc>::deallocate(alloc_, block_, blockUnits(bufferSize_));
+}
+
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+void MovingPercentile<ValType, Engine, Policy, Alloc>::reallocate(int bufferSize) {
+    deallocate();
+    allocate(bufferSize);
+    minHeap_[0] = -1;
+    maxHeap_[0] = 1;
+}
+
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+void MovingPercentile<ValType, Engine, Policy, Alloc>::grow() {
+    MOVING_PERCENTILE_STAT(doublings++);
+    std::max_align_t *oldBlock = block_;
+    ValType *oldData = data_;
+    int *oldPos = pos_, *oldMinHeap = minHeap_, *oldMaxHeap = maxHeap_;
+    int oldSize = bufferSize_;
+    allocate(oldSize * 2);
+    //1.the ring keeps its slots, only a wrapped prefix [0, curr_) moves behind the old end,
+    //so heap entries need a compare instead of a modulo and usually no change at all
+    int wrapped = curr_ < prev_ ? curr_ : 0;
+    for (int i = 0; i < oldSize; ++i) {
+        int j = i < wrapped ? i + oldSize : i;
+        data_[j] = std::move(oldData[i]);
+        pos_[j] = oldPos[i];
+    }
+    std::copy(oldMinHeap, oldMinHeap + minHeapIdx_, minHeap_);
+    std::copy(oldMaxHeap, oldMaxHeap + maxHeapIdx_, maxHeap_);
+    if (wrapped) {
+        for (int i = 1; i < minHeapIdx_; ++i)
+            minHeap_[i] += minHeap_[i] < wrapped ? oldSize : 0;
+        for (int i = 1; i < maxHeapIdx_; ++i)
+            maxHeap_[i] += maxHeap_[i] < wrapped ? oldSize : 0;
+    }
+    if (curr_ < prev_)
+        curr_ += oldSize;
+    //2.release the old block
+    for (int i = 0; i < oldSize; ++i)
+        oldData[i].~ValType();
+    std::allocator_traits<BlockAlloc>::deallocate(alloc_, oldBlock, blockUnits(oldSize));
+}
+
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+template<typename P>
+ValType MovingPercentile<ValType, Engine, Policy, Alloc>::getValImpl(P *) const {
+    //1.both heap tops are read directly, no extra sift work
+    if (maxHeapIdx_ - nullCnt_ == 1) {
+        return nullVal_;
+    }
+    const ValType &lo = data_[maxHeap_[1]];
+    const ValType &hi = minHeapIdx_ > 1 ? data_[minHeap_[1]] : lo;
+    return P::value(lo, hi, maxHeapIdx_ - nullCnt_ + minHeapIdx_ - 2, per_);
+}
+
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+ValType MovingPercentile<ValType, Engine, Policy, Alloc>::getMedVal() const {
     //1.return the top element of the right heap(or the average of the two top elements)
     if (maxHeapIdx_ - nullCnt_ == 1) {
         return nullVal_;
@@ -292,8 +621,8 @@ ValType MovingPercentile<ValType>::getMedVal() const {
     }
 }
 
-template<typename ValType>
-ValType MovingPercentile<ValType>::getPerVal() const {
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+ValType MovingPercentile<ValType, Engine, Policy, Alloc>::getPerVal() const {
     //1.return the top element of the maxHeap
     if (maxHeapIdx_ - nullCnt_ == 1) {
         return nullVal_;
@@ -302,8 +631,9 @@ ValType MovingPercentile<ValType>::getPerVal() const {
 }
 
 //insert maximum/minimum value from minHeap/maxHeap to the other heap (source heap remains intact)
-template<typename ValType>
-void MovingPercentile<ValType>::min2max() {
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+void MovingPercentile<ValType, Engine, Policy, Alloc>::min2max() {
+    MOVING_PERCENTILE_STAT(rebalances++);
     swapImpl(minHeap_, 1, minHeapIdx_ - 1);
     pos_[minHeap_[minHeapIdx_ - 1]] = maxHeapIdx_;
     maxHeap_[maxHeapIdx_++] = minHeap_[minHeapIdx_ - 1];
@@ -312,8 +642,9 @@ void MovingPercentile<ValType>::min2max() {
     minSortDown(1);
 }
 
-template<typename ValType>
-void MovingPercentile<ValType>::max2min() {
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+void MovingPercentile<ValType, Engine, Policy, Alloc>::max2min() {
+    MOVING_PERCENTILE_STAT(rebalances++);
     swapImpl(maxHeap_, 1, maxHeapIdx_ - 1);
     pos_[maxHeap_[maxHeapIdx_ - 1]] = minHeapIdx_ * -1;
     minHeap_[minHeapIdx_++] = maxHeap_[maxHeapIdx_ - 1];
@@ -323,8 +654,8 @@ void MovingPercentile<ValType>::max2min() {
 }
 
 //swaps items i & j in heap, maintains indices
-template<typename ValType>
-bool MovingPercentile<ValType>::swapImpl(int *heap_, int i, int j) {
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+bool MovingPercentile<ValType, Engine, Policy, Alloc>::swapImpl(int *heap_, int i, int j) {
     int t = heap_[i];
     heap_[i] = heap_[j];
     heap_[j] = t;
@@ -334,49 +665,59 @@ bool MovingPercentile<ValType>::swapImpl(int *heap_, int i, int j) {
 }
 
 //swaps items i & j if i < j, returns true if swapped
-template<typename ValType>
-bool MovingPercentile<ValType>::mmCmpExch(int *heap_, int i, int j) {
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+bool MovingPercentile<ValType, Engine, Policy, Alloc>::mmCmpExch(int *heap_, int i, int j) {
     return data_[heap_[i]] < data_[heap_[j]] && swapImpl(heap_, i, j);
 }
 
 //maintains min heap property for all items below i/2
-template<typename ValType>
-void MovingPercentile<ValType>::minSortDown(int i) {
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+void MovingPercentile<ValType, Engine, Policy, Alloc>::minSortDown(int i) {
+    MOVING_PERCENTILE_STAT(siftDowns++);
     int minHeapCount = minHeapIdx_ - 1;
     for (; i <= minHeapCount; i *= 2) {
         if (i > 1 && i < minHeapCount && data_[minHeap_[i + 1]] < data_[minHeap_[i]])
             ++i;
         if (i > 1 && !mmCmpExch(minHeap_, i, i / 2))
             break;
+        MOVING_PERCENTILE_STAT(siftDownSteps += i > 1);
     }
 }
 
 //maintains max heap property for all items below i/2
-template<typename ValType>
-void MovingPercentile<ValType>::maxSortDown(int i) {
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+void MovingPercentile<ValType, Engine, Policy, Alloc>::maxSortDown(int i) {
+    MOVING_PERCENTILE_STAT(siftDowns++);
     int maxHeapCount = maxHeapIdx_ - 1;
     for (; i <= maxHeapCount; i *= 2) {
         if (i > 1 && i < maxHeapCount && data_[maxHeap_[i]] < data_[maxHeap_[i + 1]])
             ++i;
         if (i > 1 && !mmCmpExch(maxHeap_, i / 2, i))
             break;
+        MOVING_PERCENTILE_STAT(siftDownSteps += i > 1);
     }
 }
 
 //maintains min heap property for all items above i, including median
 //returns true if median changed
-template<typename ValType>
-bool MovingPercentile<ValType>::minSortUp(int i) {
-    while (i > 1 && mmCmpExch(minHeap_, i, i / 2))
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+bool MovingPercentile<ValType, Engine, Policy, Alloc>::minSortUp(int i) {
+    MOVING_PERCENTILE_STAT(siftUps++);
+    while (i > 1 && mmCmpExch(minHeap_, i, i / 2)) {
         i /= 2;
+        MOVING_PERCENTILE_STAT(siftUpSteps++);
+    }
     return i == 0;
 }
 
 //maintains max heap property for all items above i, including median
 //returns true if median changed
-template<typename ValType>
-bool MovingPercentile<ValType>::maxSortUp(int i) {
-    while (i > 1 && mmCmpExch(maxHeap_, i / 2, i))
+template<typename ValType, typename Engine, typename Policy, typename Alloc>
+bool MovingPercentile<ValType, Engine, Policy, Alloc>::maxSortUp(int i) {
+    MOVING_PERCENTILE_STAT(siftUps++);
+    while (i > 1 && mmCmpExch(maxHeap_, i / 2, i)) {
         i /= 2;
+        MOVING_PERCENTILE_STAT(siftUpSteps++);
+    }
     return i == 0;
 }
\ No newline at end of file
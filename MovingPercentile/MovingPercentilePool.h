@@ -0,0 +1,186 @@
+/*
+ *  MovingPercentilePool.h
+ *
+ *  Created on : Oct 17, 2026
+ *  Millions of small moving percentile windows addressed by integer key
+ *  All windows share the same capacity and live in a few contiguous struct-of-arrays slabs,
+ *  so a key costs 2 * window values plus 6 bytes instead of four separate heap allocations
+ *  Each window is a sorted block (see SortedBlockPercentile.h), it needs no heap positions or indices per item,
+ *  which is what keeps a key at 2 * window values
+ */
+
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cassert>
+#include "SortedBlockPercentile.h"
+
+template<typename ValType>
+class MovingPercentilePool {
+public:
+    MovingPercentilePool(ValType nullVal, int window, bool med = false, double per = 50.0, int initKeys = 0)
+        : nullVal_(nullVal), window_(window), med_(med), per_(med ? 50.0 : per), keys_(0) {
+        assert(window > 0 && window <= 0xffff);
+        resize(initKeys);
+    }
+    //keys are dense in [0, keys()), inserting to a larger key grows the pool
+    void resize(int keys);
+    int keys() const { return keys_; }
+    void clear(int key) {
+        if (key >= keys_)
+            return;
+        head_[key] = 0;
+        count_[key] = 0;
+        sortedLen_[key] = 0;
+    }
+    ValType getVal(int key) const;
+    void getVals(const int *keys, ValType *vals, int n) const;
+    //a full window slides, the oldest item is evicted
+    void insert(int key, ValType val);
+    void remove(int key);
+    //only slides a window that already has items, updates to an unknown key or an empty window are dropped
+    void insertAndRemove(int key, ValType val);
+    //batches are grouped by key (keeping their order per key) so each window is touched once per batch,
+    //insert fills and slides like insert(int, ValType), insertAndRemove drops like insertAndRemove(int, ValType)
+    void insert(const int *keys, const ValType *vals, int n);
+    void insertAndRemove(const int *keys, const ValType *vals, int n);
+    int size(int key) const { return key < keys_ ? count_[key] : 0; }
+private:
+    //stable sort of update indices by key into order_, keeping the order within each key
+    void groupByKey(const int *keys, int n);
+    void slide(int key, ValType val);
+
+    ValType nullVal_;
+    int window_;
+    bool med_;
+    double per_;
+    int keys_;
+    //window k owns [k * window_, (k + 1) * window_) of ring_ and sorted_
+    std::vector<ValType> ring_, sorted_;
+    std::vector<uint16_t> head_, count_, sortedLen_;
+    //scratch buffer for batch grouping, reused across batches
+    std::vector<int> order_;
+};
+
+template<typename ValType>
+void MovingPercentilePool<ValType>::resize(int keys) {
+    if (keys <= keys_)
+        return;
+    size_t slots = static_cast<size_t>(keys) * window_;
+    ring_.resize(slots);
+    sorted_.resize(slots);
+    head_.resize(keys, 0);
+    count_.resize(keys, 0);
+    sortedLen_.resize(keys, 0);
+    keys_ = keys;
+}
+
+template<typename ValType>
+ValType MovingPercentilePool<ValType>::getVal(int key) const {
+    if (key >= keys_)
+        return nullVal_;
+    int n = sortedLen_[key];
+    int lowerCount = n - static_cast<int>(n * (100.0 - per_) / 100.0);
+    if (lowerCount <= 0)
+        return nullVal_;
+    const ValType *sorted = &sorted_[static_cast<size_t>(key) * window_];
+    if (med_ && n % 2 == 0)
+        return (sorted[lowerCount - 1] + sorted[lowerCount]) / 2.0;
+    return sorted[lowerCount - 1];
+}
+
+template<typename ValType>
+void MovingPercentilePool<ValType>::getVals(const int *keys, ValType *vals, int n) const {
+    for (int i = 0; i < n; ++i)
+        vals[i] = getVal(keys[i]);
+}
+
+template<typename ValType>
+void MovingPercentilePool<ValType>::insert(int key, ValType val) {
+    if (key >= keys_)
+        resize(std::max(key + 1, keys_ * 2));
+    if (count_[key] == window_) {
+        slide(key, val);
+        return;
+    }
+    size_t base = static_cast<size_t>(key) * window_;
+    ring_[base + (head_[key] + count_[key]) % window_] = val;
+    count_[key]++;
+    if (val == nullVal_)
+        return;
+    ValType *sorted = &sorted_[base];
+    int len = sortedLen_[key];
+    int i = sortedUpperBound(sorted, len, val);
+    std::copy_backward(sorted + i, sorted + len, sorted + len + 1);
+    sorted[i] = val;
+    sortedLen_[key]++;
+}
+
+template<typename ValType>
+void MovingPercentilePool<ValType>::remove(int key) {
+    if (key >= keys_ || count_[key] == 0)
+        return;
+    size_t base = static_cast<size_t>(key) * window_;
+    ValType old = ring_[base + head_[key]];
+    head_[key] = (head_[key] + 1) % window_;
+    count_[key]--;
+    if (old == nullVal_)
+        return;
+    ValType *sorted = &sorted_[base];
+    int len = sortedLen_[key];
+    int r = sortedLowerBound(sorted, len, old);
+    std::copy(sorted + r + 1, sorted + len, sorted + r);
+    sortedLen_[key]--;
+}
+
+template<typename ValType>
+void MovingPercentilePool<ValType>::insertAndRemove(int key, ValType val) {
+    if (key >= keys_ || count_[key] == 0)
+        return;
+    slide(key, val);
+}
+
+template<typename ValType>
+void MovingPercentilePool<ValType>::groupByKey(const int *keys, int n) {
+    order_.resize(n);
+    for (int i = 0; i < n; ++i)
+        order_[i] = i;
+    std::stable_sort(order_.begin(), order_.end(), [keys](int a, int b) { return keys[a] < keys[b]; });
+}
+
+template<typename ValType>
+void MovingPercentilePool<ValType>::insert(const int *keys, const ValType *vals, int n) {
+    //1.group the updates, the largest key grows the pool once
+    groupByKey(keys, n);
+    if (n > 0 && keys[order_[n - 1]] >= keys_)
+        resize(std::max(keys[order_[n - 1]] + 1, keys_ * 2));
+    //2.apply every run of updates to one window while it is hot in cache
+    for (int i = 0; i < n; ++i)
+        insert(keys[order_[i]], vals[order_[i]]);
+}
+
+template<typename ValType>
+void MovingPercentilePool<ValType>::insertAndRemove(const int *keys, const ValType *vals, int n) {
+    //1.group the updates
+    groupByKey(keys, n);
+    //2.apply every run of updates to one window while it is hot in cache
+    for (int i = 0; i < n; ++i)
+        insertAndRemove(keys[order_[i]], vals[order_[i]]);
+}
+
+template<typename ValType>
+void MovingPercentilePool<ValType>::slide(int key, ValType val) {
+    size_t base = static_cast<size_t>(key) * window_;
+    ValType old = ring_[base + head_[key]];
+    if (old == nullVal_ || val == nullVal_) {
+        remove(key);
+        insert(key, val);
+        return;
+    }
+    //1.the new value takes over the slot of the oldest one
+    ring_[base + (head_[key] + count_[key]) % window_] = val;
+    head_[key] = (head_[key] + 1) % window_;
+    //2.shift only the items between the evicted position and the insert position
+    sortedReplace(&sorted_[base], static_cast<int>(sortedLen_[key]), old, val);
+}
@@ -0,0 +1,124 @@
+/*
+ *  NumpyPercentileTest.cpp
+ *
+ *  Created on : Oct 17, 2026
+ *  Checks the numpy-compatible policies against numpy.percentile(np.arange(n), per, method=...) (numpy 2.4)
+ *  The cases are the (n, per) pairs in n = 2..200, per = 1..99 where (n - 1) * per / 100 and
+ *  (n - 1) * (per / 100) round differently, plus a few plain ones
+ *
+ *  g++ -std=c++14 NumpyPercentileTest.cpp -o NumpyPercentileTest && ./NumpyPercentileTest
+ */
+
+#include <cstdio>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include "MovingPercentile.h"
+
+struct NumpyCase {
+    int n, per;
+    //linear, lower, higher, nearest, midpoint
+    double expected[5];
+};
+
+static const NumpyCase Cases[] = {
+    { 1, 0, { 0.0, 0.0, 0.0, 0.0, 0.0 } },
+    { 1, 50, { 0.0, 0.0, 0.0, 0.0, 0.0 } },
+    { 1, 100, { 0.0, 0.0, 0.0, 0.0, 0.0 } },
+    { 2, 50, { 0.5, 0.0, 1.0, 0.0, 0.5 } },
+    { 4, 50, { 1.5, 1.0, 2.0, 2.0, 1.5 } },
+    { 5, 50, { 2.0, 2.0, 2.0, 2.0, 2.0 } },
+    { 10, 0, { 0.0, 0.0, 0.0, 0.0, 0.0 } },
+    { 10, 25, { 2.25, 2.0, 3.0, 2.0, 2.5 } },
+    { 10, 90, { 8.1, 8.0, 9.0, 8.0, 8.5 } },
+    { 10, 100, { 9.0, 9.0, 9.0, 9.0, 9.0 } },
+    { 11, 50, { 5.0, 5.0, 5.0, 5.0, 5.0 } },
+    { 101, 99, { 99.0, 99.0, 99.0, 99.0, 99.0 } },
+    { 26, 14, { 3.5000000000000004, 3.0, 4.0, 4.0, 3.5 } },
+    { 26, 28, { 7.000000000000001, 7.0, 8.0, 7.0, 7.5 } },
+    { 26, 56, { 14.000000000000002, 14.0, 15.0, 14.0, 14.5 } },
+    { 26, 58, { 14.499999999999998, 14.0, 15.0, 14.0, 14.5 } },
+    { 46, 70, { 31.499999999999996, 31.0, 32.0, 31.0, 31.5 } },
+    { 51, 7, { 3.5000000000000004, 3.0, 4.0, 4.0, 3.5 } },
+    { 51, 14, { 7.000000000000001, 7.0, 8.0, 7.0, 7.5 } },
+    { 51, 28, { 14.000000000000002, 14.0, 15.0, 14.0, 14.5 } },
+    { 51, 29, { 14.499999999999998, 14.0, 15.0, 14.0, 14.5 } },
+    { 51, 55, { 27.500000000000004, 27.0, 28.0, 28.0, 27.5 } },
+    { 51, 56, { 28.000000000000004, 28.0, 29.0, 28.0, 28.5 } },
+    { 51, 57, { 28.499999999999996, 28.0, 29.0, 28.0, 28.5 } },
+    { 51, 58, { 28.999999999999996, 28.0, 29.0, 29.0, 28.5 } },
+    { 76, 14, { 10.500000000000002, 10.0, 11.0, 11.0, 10.5 } },
+    { 76, 28, { 21.000000000000004, 21.0, 22.0, 21.0, 21.5 } },
+    { 76, 34, { 25.500000000000004, 25.0, 26.0, 26.0, 25.5 } },
+    { 76, 56, { 42.00000000000001, 42.0, 43.0, 42.0, 42.5 } },
+    { 76, 68, { 51.00000000000001, 51.0, 52.0, 51.0, 51.5 } },
+    { 76, 82, { 61.49999999999999, 61.0, 62.0, 61.0, 61.5 } },
+    { 86, 70, { 59.49999999999999, 59.0, 60.0, 59.0, 59.5 } },
+    { 91, 35, { 31.499999999999996, 31.0, 32.0, 31.0, 31.5 } },
+    { 91, 55, { 49.50000000000001, 49.0, 50.0, 50.0, 49.5 } },
+    { 91, 70, { 62.99999999999999, 62.0, 63.0, 63.0, 62.5 } },
+    { 101, 7, { 7.000000000000001, 7.0, 8.0, 7.0, 7.5 } },
+    { 101, 14, { 14.000000000000002, 14.0, 15.0, 14.0, 14.5 } },
+    { 101, 28, { 28.000000000000004, 28.0, 29.0, 28.0, 28.5 } },
+    { 101, 29, { 28.999999999999996, 28.0, 29.0, 29.0, 28.5 } },
+    { 101, 55, { 55.00000000000001, 55.0, 56.0, 55.0, 55.5 } },
+    { 101, 56, { 56.00000000000001, 56.0, 57.0, 56.0, 56.5 } },
+    { 101, 57, { 56.99999999999999, 56.0, 57.0, 57.0, 56.5 } },
+    { 101, 58, { 57.99999999999999, 57.0, 58.0, 58.0, 57.5 } },
+    { 111, 55, { 60.50000000000001, 60.0, 61.0, 61.0, 60.5 } },
+    { 151, 7, { 10.500000000000002, 10.0, 11.0, 11.0, 10.5 } },
+    { 151, 14, { 21.000000000000004, 21.0, 22.0, 21.0, 21.5 } },
+    { 151, 17, { 25.500000000000004, 25.0, 26.0, 26.0, 25.5 } },
+    { 151, 28, { 42.00000000000001, 42.0, 43.0, 42.0, 42.5 } },
+    { 151, 34, { 51.00000000000001, 51.0, 52.0, 51.0, 51.5 } },
+    { 151, 41, { 61.49999999999999, 61.0, 62.0, 61.0, 61.5 } },
+    { 151, 56, { 84.00000000000001, 84.0, 85.0, 84.0, 84.5 } },
+    { 151, 57, { 85.49999999999999, 85.0, 86.0, 85.0, 85.5 } },
+    { 151, 68, { 102.00000000000001, 102.0, 103.0, 102.0, 102.5 } },
+    { 151, 69, { 103.49999999999999, 103.0, 104.0, 103.0, 103.5 } },
+    { 151, 81, { 121.50000000000001, 121.0, 122.0, 122.0, 121.5 } },
+    { 151, 82, { 122.99999999999999, 122.0, 123.0, 123.0, 122.5 } },
+    { 166, 70, { 115.49999999999999, 115.0, 116.0, 115.0, 115.5 } },
+    { 171, 35, { 59.49999999999999, 59.0, 60.0, 59.0, 59.5 } },
+    { 171, 55, { 93.50000000000001, 93.0, 94.0, 94.0, 93.5 } },
+    { 171, 70, { 118.99999999999999, 118.0, 119.0, 119.0, 118.5 } },
+    { 176, 14, { 24.500000000000004, 24.0, 25.0, 25.0, 24.5 } },
+    { 176, 28, { 49.00000000000001, 49.0, 50.0, 49.0, 49.5 } },
+    { 176, 34, { 59.50000000000001, 59.0, 60.0, 60.0, 59.5 } },
+    { 176, 56, { 98.00000000000001, 98.0, 99.0, 98.0, 98.5 } },
+    { 176, 68, { 119.00000000000001, 119.0, 120.0, 119.0, 119.5 } },
+    { 176, 70, { 122.49999999999999, 122.0, 123.0, 122.0, 122.5 } },
+    { 181, 35, { 62.99999999999999, 62.0, 63.0, 63.0, 62.5 } },
+    { 181, 55, { 99.00000000000001, 99.0, 100.0, 99.0, 99.5 } },
+    { 181, 70, { 125.99999999999999, 125.0, 126.0, 126.0, 125.5 } },
+    { 191, 55, { 104.50000000000001, 104.0, 105.0, 105.0, 104.5 } },
+};
+
+//percentile of 0..n-1 inserted in a shuffled order
+template<typename Policy>
+double percentile(int n, double per) {
+    std::vector<double> vals(n);
+    for (int i = 0; i < n; ++i)
+        vals[i] = i;
+    std::shuffle(vals.begin(), vals.end(), std::mt19937(n));
+    MovingPercentile<double, DualHeap, Policy> mp(-1.0, false, per);
+    mp.insert(vals.data(), n);
+    return mp.getVal();
+}
+
+int main() {
+    const char *methods[] = { "linear", "lower", "higher", "nearest", "midpoint" };
+    int failed = 0;
+    for (const NumpyCase &c : Cases) {
+        double got[5] = { percentile<LinearPercentile>(c.n, c.per), percentile<LowerPercentile>(c.n, c.per),
+            percentile<HigherPercentile>(c.n, c.per), percentile<NearestPercentile>(c.n, c.per), percentile<MidpointPercentile>(c.n, c.per) };
+        for (int m = 0; m < 5; ++m) {
+            if (got[m] != c.expected[m]) {
+                printf("<FAILED> n=%d per=%d method=%s: %.17g, numpy %.17g\n", c.n, c.per, methods[m], got[m], c.expected[m]);
+                ++failed;
+            }
+        }
+    }
+    printf("%s\n", failed ? "numpy percentile check failed" : "numpy percentile check passed");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,249 @@
+/*
+ *  QuantileSketch.h
+ *
+ *  Created on : Oct 17, 2026
+ *  Bounded-memory approximate percentiles based on the KLL sketch (Karnin, Lang, Liberty 2016)
+ *  A sketch keeps at most about 3 * k items whatever the stream length
+ *  Normalized rank error is about 2.3 / k^0.97 with 99% confidence (1.3% for the default k = 200)
+ *  Sketches are mergeable, per-thread or per-shard sketches can be combined without raw samples
+ */
+
+#pragma once
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <utility>
+#include <cmath>
+#include <cstdint>
+
+template<typename ValType>
+class QuantileSketch {
+public:
+    explicit QuantileSketch(ValType nullVal, int k = 200, uint32_t seed = 0x9e3779b9U)
+        : nullVal_(nullVal), k_(std::max(k, 8)), n_(0), seed_(seed ? seed : 1), levels_(1) {}
+    void clear() {
+        n_ = 0;
+        levels_.assign(1, std::vector<ValType>());
+    }
+    //percentile definition matches MovingPercentile, the returned item is within rankError() of the exact one
+    ValType getVal(double per) const;
+    void getVals(const double *pers, ValType *vals, int len) const;
+    void insert(ValType val);
+    void insert(const ValType *vals, int len);
+    void merge(const QuantileSketch &other);
+    //number of non-null items summarized
+    long long count() const { return n_; }
+    //number of items actually kept
+    int retained() const;
+    double rankError() const { return 2.296 / std::pow(static_cast<double>(k_), 0.9723); }
+private:
+    int capacity(int level) const {
+        int depth = static_cast<int>(levels_.size()) - 1 - level;
+        return std::max(8, static_cast<int>(k_ * std::pow(2.0 / 3.0, depth)));
+    }
+    void compress();
+    void compactLevel(int level);
+
+    ValType nullVal_;
+    int k_;
+    long long n_;
+    uint32_t seed_;
+    //items in level h stand for 2^h original items
+    std::vector<std::vector<ValType>> levels_;
+};
+
+template<typename ValType>
+ValType QuantileSketch<ValType>::getVal(double per) const {
+    ValType val;
+    getVals(&per, &val, 1);
+    return val;
+}
+
+template<typename ValType>
+void QuantileSketch<ValType>::getVals(const double *pers, ValType *vals, int len) const {
+    //1.flatten all levels into (value, weight) pairs sorted by value, once for all percentiles
+    std::vector<std::pair<ValType, long long>> items;
+    items.reserve(retained());
+    for (size_t h = 0; h < levels_.size(); ++h) {
+        for (const auto &val : levels_[h])
+            items.emplace_back(val, 1LL << h);
+    }
+    std::sort(items.begin(), items.end(), [](const std::pair<ValType, long long> &a, const std::pair<ValType, long long> &b) {
+        return a.first < b.first;
+    });
+    for (size_t i = 1; i < items.size(); ++i)
+        items[i].second += items[i - 1].second;
+    //2.the weights add up to n, find the first item covering the target rank
+    for (int i = 0; i < len; ++i) {
+        long long lowerCount = n_ - static_cast<long long>(n_ * (100.0 - pers[i]) / 100.0);
+        if (lowerCount <= 0 || items.empty()) {
+            vals[i] = nullVal_;
+            continue;
+        }
+        auto it = std::lower_bound(items.begin(), items.end(), lowerCount,
+            [](const std::pair<ValType, long long> &item, long long rank) { return item.second < rank; });
+        vals[i] = it == items.end() ? items.back().first : it->first;
+    }
+}
+
+template<typename ValType>
+void QuantileSketch<ValType>::insert(ValType val) {
+    if (val == nullVal_)
+        return;
+    levels_[0].push_back(val);
+    n_++;
+    if (static_cast<int>(levels_[0].size()) >= capacity(0))
+        compress();
+}
+
+template<typename ValType>
+void QuantileSketch<ValType>::insert(const ValType *vals, int len) {
+    for (int i = 0; i < len; ++i)
+        insert(vals[i]);
+}
+
+template<typename ValType>
+void QuantileSketch<ValType>::merge(const QuantileSketch &other) {
+    //inserting a level into itself is undefined, merge a copy instead
+    if (&other == this) {
+        QuantileSketch copy(other);
+        merge(copy);
+        return;
+    }
+    if (other.levels_.size() > levels_.size())
+        levels_.resize(other.levels_.size());
+    for (size_t h = 0; h < other.levels_.size(); ++h)
+        levels_[h].insert(levels_[h].end(), other.levels_[h].begin(), other.levels_[h].end());
+    n_ += other.n_;
+    compress();
+}
+
+template<typename ValType>
+int QuantileSketch<ValType>::retained() const {
+    int total = 0;
+    for (const auto &level : levels_)
+        total += static_cast<int>(level.size());
+    return total;
+}
+
+template<typename ValType>
+void QuantileSketch<ValType>::compress() {
+    //compact the lowest full level until every level fits, a compaction may add a new top level
+    bool compacted = true;
+    while (compacted) {
+        compacted = false;
+        for (size_t h = 0; h < levels_.size(); ++h) {
+            if (static_cast<int>(levels_[h].size()) >= capacity(static_cast<int>(h))) {
+                compactLevel(static_cast<int>(h));
+                compacted = true;
+                break;
+            }
+        }
+    }
+}
+
+template<typename ValType>
+void QuantileSketch<ValType>::compactLevel(int level) {
+    if (level + 1 == static_cast<int>(levels_.size()))
+        levels_.emplace_back();
+    std::vector<ValType> &src = levels_[level];
+    std::vector<ValType> &dst = levels_[level + 1];
+    std::sort(src.begin(), src.end());
+    //1.an odd item stays behind so the total weight is preserved exactly
+    ValType leftover = src.back();
+    bool odd = src.size() % 2 == 1;
+    size_t even = src.size() - (odd ? 1 : 0);
+    //2.promote every other item with a random offset, each survivor doubles its weight
+    seed_ ^= seed_ << 13;
+    seed_ ^= seed_ >> 17;
+    seed_ ^= seed_ << 5;
+    for (size_t i = seed_ & 1; i < even; i += 2)
+        dst.push_back(src[i]);
+    src.clear();
+    if (odd)
+        src.push_back(leftover);
+}
+
+/*
+ * Approximate moving percentile for very long windows with fixed memory
+ * The window is split into blocks of blockSize samples, each block is summarized by a sketch
+ * blockSize is raised to ceil(window / MaxBlocks) and clamped to [1, window], so at most MaxBlocks + 3 sketches
+ * (about 3 * k items each) are kept whatever the window, and a sealed block re-merges at most MaxBlocks sketches
+ * Eviction works on whole blocks, with blocks = ceil(window / blockSize) the window covers
+ * the last blocks * blockSize to (blocks + 1) * blockSize - 1 samples
+ */
+template<typename ValType>
+class ApproxMovingPercentile {
+public:
+    static const int MaxBlocks = 64;
+    ApproxMovingPercentile(ValType nullVal, int window, int blockSize = 4096, int k = 200)
+        : nullVal_(nullVal), blockSize_(blockSizeFor(window, blockSize)),
+        blocks_(std::max(1, window / blockSize_ + (window % blockSize_ != 0))), k_(k), filled_(0),
+        current_(nullVal, k), merged_(nullVal, k), combined_(nullVal, k), dirty_(false), stale_(false) {}
+    void clear() {
+        sealed_.clear();
+        current_.clear();
+        merged_.clear();
+        combined_.clear();
+        filled_ = 0;
+        dirty_ = false;
+        stale_ = false;
+    }
+    ValType getVal(double per) const;
+    void insert(ValType val);
+    void insert(const ValType *vals, int len);
+    double rankError() const { return current_.rankError(); }
+    int blockSize() const { return blockSize_; }
+private:
+    static int blockSizeFor(int window, int blockSize) {
+        int minSize = window / MaxBlocks + (window % MaxBlocks != 0);
+        return std::max(1, std::min(std::max(blockSize, minSize), window));
+    }
+
+    ValType nullVal_;
+    int blockSize_, blocks_, k_, filled_;
+    std::deque<QuantileSketch<ValType>> sealed_;
+    QuantileSketch<ValType> current_;
+    //merge of all sealed blocks, rebuilt lazily once per sealed block
+    mutable QuantileSketch<ValType> merged_;
+    //merged_ plus current_, rebuilt lazily once per insert so repeated queries are free
+    mutable QuantileSketch<ValType> combined_;
+    mutable bool dirty_, stale_;
+};
+
+template<typename ValType>
+ValType ApproxMovingPercentile<ValType>::getVal(double per) const {
+    if (dirty_) {
+        merged_.clear();
+        for (const auto &block : sealed_)
+            merged_.merge(block);
+        dirty_ = false;
+    }
+    if (stale_) {
+        combined_ = merged_;
+        combined_.merge(current_);
+        stale_ = false;
+    }
+    return combined_.getVal(per);
+}
+
+template<typename ValType>
+void ApproxMovingPercentile<ValType>::insert(ValType val) {
+    current_.insert(val);
+    stale_ = true;
+    if (++filled_ < blockSize_)
+        return;
+    //seal the full block and drop the oldest one beyond the window
+    sealed_.push_back(current_);
+    if (static_cast<int>(sealed_.size()) > blocks_)
+        sealed_.pop_front();
+    current_.clear();
+    filled_ = 0;
+    dirty_ = true;
+}
+
+template<typename ValType>
+void ApproxMovingPercentile<ValType>::insert(const ValType *vals, int len) {
+    for (int i = 0; i < len; ++i)
+        insert(vals[i]);
+}
@@ -0,0 +1,63 @@
+/*
+ *  RollingPercentile.h
+ *
+ *  Created on : Oct 17, 2026
+ *  Rolling median/percentile filter over a whole series
+ *  out[i] is the percentile of in[i - window + 1 .. i], the first window - 1 outputs use the shorter prefix
+ *  Long series are split into chunks across threads, each chunk is warm-started from the
+ *  window - 1 samples before it, so the output does not depend on the thread count
+ */
+
+#pragma once
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include "MovingPercentile.h"
+
+template<typename ValType, typename Engine, typename Policy>
+void rollingPercentileChunk(const ValType *in, ValType *out, int begin, int end, int window,
+    ValType nullVal, bool med, double per) {
+    MovingPercentile<ValType, Engine, Policy> mov(nullVal, med, per, window + 2);
+    //1.warm up with the overlap from the previous chunk
+    int warm = std::max(0, begin - window + 1);
+    mov.insert(in + warm, begin - warm);
+    //2.slide over the chunk and record every step
+    for (int i = begin; i < end; ++i) {
+        if (mov.size() < window)
+            mov.insert(in[i]);
+        else
+            mov.insertAndRemove(in[i]);
+        out[i] = mov.getVal();
+    }
+}
+
+/*
+ * @param {threads} number of worker threads, 0 for std::thread::hardware_concurrency()
+ *
+ * @example: rollingPercentile(in, out, len, 101, -1.0, true) for a 101-point rolling median
+ */
+template<typename ValType, typename Engine = DualHeap, typename Policy = DefaultPercentile>
+void rollingPercentile(const ValType *in, ValType *out, int len, int window,
+    ValType nullVal, bool med = false, double per = 50.0, int threads = 0) {
+    if (len <= 0 || window <= 0)
+        return;
+    if (threads <= 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    //keep every chunk several windows long so the warm-up overlap stays a small fraction
+    int chunks = std::max(1, std::min(threads, len / (window * 4)));
+    if (chunks == 1) {
+        rollingPercentileChunk<ValType, Engine, Policy>(in, out, 0, len, window, nullVal, med, per);
+        return;
+    }
+    std::vector<std::thread> pool;
+    pool.reserve(chunks - 1);
+    int step = len / chunks;
+    for (int c = 1; c < chunks; ++c) {
+        int begin = c * step;
+        int end = c == chunks - 1 ? len : begin + step;
+        pool.emplace_back(rollingPercentileChunk<ValType, Engine, Policy>, in, out, begin, end, window, nullVal, med, per);
+    }
+    rollingPercentileChunk<ValType, Engine, Policy>(in, out, 0, step, window, nullVal, med, per);
+    for (auto &t : pool)
+        t.join();
+}
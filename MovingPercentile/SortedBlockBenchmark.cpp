@@ -0,0 +1,63 @@
+/*
+ *  SortedBlockBenchmark.cpp
+ *
+ *  Created on : Oct 17, 2026
+ *  Produces the DualHeap/SortedBlock crossover table in SortedBlockPercentile.h
+ *  p90, one insertAndRemove + getVal per sample over 2M samples after the window is filled
+ *  random: uniform [0, 1), trending: 0.01 * i plus uniform [0, 1) noise, so new samples are mostly the largest
+ *
+ *  g++ -std=c++14 -O2 SortedBlockBenchmark.cpp -o SortedBlockBenchmark && ./SortedBlockBenchmark
+ */
+
+#include <cstdio>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <iterator>
+#include "SortedBlockPercentile.h"
+
+//ns per insertAndRemove + getVal, sink keeps the results alive
+template<typename Window>
+double measure(const std::vector<double> &vals, int window, double &sink) {
+    Window mp(-1.0, false, 90.0, window * 2);
+    mp.insert(vals.data(), window);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = window; i < vals.size(); ++i) {
+        mp.insertAndRemove(vals[i]);
+        sink += mp.getVal();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / (vals.size() - window);
+}
+
+//same columns as the table in SortedBlockPercentile.h
+void printRow(const char *data, const char *engine, const std::vector<double> &cols, const char *unit) {
+    printf("%-9s%-6s", data, engine);
+    for (size_t i = 0; i < cols.size(); ++i)
+        printf(i ? "%6.0f" : "%5.0f", cols[i]);
+    printf("%s\n", unit);
+}
+
+int main() {
+    const int windows[] = { 8, 16, 32, 64, 128, 256, 1024 };
+    const int samples = 2000000;
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<double> uniform;
+    double sink = 0;
+    printRow("window", "", std::vector<double>(std::begin(windows), std::end(windows)), "");
+    for (int trending = 0; trending < 2; ++trending) {
+        std::vector<double> vals(samples);
+        for (int i = 0; i < samples; ++i)
+            vals[i] = (trending ? i * 0.01 : 0.0) + uniform(gen);
+        std::vector<double> heap, sorted;
+        for (int window : windows) {
+            heap.push_back(measure<MovingPercentile<double>>(vals, window, sink));
+            sorted.push_back(measure<MovingPercentile<double, SortedBlock>>(vals, window, sink));
+        }
+        printRow(trending ? "trending" : "random", "heap", heap, "  ns/op");
+        printRow("", "sorted", sorted, "  ns/op");
+    }
+    //prevents the loops from being optimized away
+    printf("checksum %g\n", sink);
+    return 0;
+}
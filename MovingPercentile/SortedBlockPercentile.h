@@ -0,0 +1,220 @@
+/*
+ *  SortedBlockPercentile.h
+ *
+ *  Created on : Oct 17, 2026
+ *  MovingPercentile<ValType, SortedBlock, Policy> keeps the window in one sorted contiguous array
+ *  Evict is a branchless binary search, insert shifts only the items between the two positions
+ *  Any rank or percentile is an O(1) lookup
+ *
+ *  Measured against the DualHeap engine by SortedBlockBenchmark.cpp (p90, insertAndRemove + getVal, g++ -O2, x86-64 VM):
+ *    window             8    16    32    64   128   256  1024
+ *    random   heap     41    39    48    47    49    53    67  ns/op
+ *             sorted   50    60    69    82    86   105   128  ns/op
+ *    trending heap     33    34    37    45    52    59    78  ns/op
+ *             sorted   44    57    63    79    82    87   145  ns/op
+ *  There is no crossover, DualHeap is faster at every size for a single percentile
+ *  SortedBlock only pays off when many ranks are read from the same window (getRankVal is O(1))
+ */
+
+#pragma once
+#include <vector>
+#include <algorithm>
+#include "MovingPercentile.h"
+
+//branchless lower_bound/upper_bound, the loop compiles to cmov and has a fixed trip count
+template<typename ValType>
+int sortedLowerBound(const ValType *first, int len, const ValType &val) {
+    if (len == 0)
+        return 0;
+    const ValType *base = first;
+    while (len > 1) {
+        int half = len / 2;
+        base = base[half] < val ? base + half : base;
+        len -= half;
+    }
+    return static_cast<int>(base - first) + (*base < val);
+}
+
+template<typename ValType>
+int sortedUpperBound(const ValType *first, int len, const ValType &val) {
+    if (len == 0)
+        return 0;
+    const ValType *base = first;
+    while (len > 1) {
+        int half = len / 2;
+        base = val < base[half] ? base : base + half;
+        len -= half;
+    }
+    return static_cast<int>(base - first) + !(val < *base);
+}
+
+//replaces old (which must be in the block) by val, both positions are found by the branchless search
+//and only the items between them move in one block copy (memmove for trivially copyable types)
+template<typename ValType>
+void sortedReplace(ValType *first, int len, const ValType &old, const ValType &val) {
+    int i = sortedLowerBound(first, len, old);
+    if (val < old) {
+        int j = sortedUpperBound(first, i, val);
+        std::copy_backward(first + j, first + i, first + i + 1);
+        first[j] = val;
+    }
+    else {
+        int j = i + 1 + sortedUpperBound(first + i + 1, len - i - 1, val);
+        std::copy(first + i + 1, first + j, first + i);
+        first[j - 1] = val;
+    }
+}
+
+template<typename ValType, typename Policy>
+class MovingPercentile<ValType, SortedBlock, Policy> {
+public:
+    explicit MovingPercentile(ValType nullVal, bool med = false, double per = 50.0, int initBufSize = 1024);
+    void clear() {
+        curr_ = 0;
+        prev_ = 0;
+        count_ = 0;
+        sortedLen_ = 0;
+        lowerCount_ = 0;
+    }
+    ValType getVal() const { return getValImpl(static_cast<Policy *>(nullptr)); }
+    //any rank is available in O(1), k is 0-based over non-null values
+    ValType getRankVal(int k) const { return k >= 0 && k < sortedLen_ ? sorted_[k] : nullVal_; }
+    void remove();
+    void remove(int nums);
+    void insert(ValType val);
+    void insert(const ValType *vals, int len);
+    void insertAndRemove(ValType val);
+    void insertAndRemove(const ValType *vals, int len);
+    int size() const { return count_; }
+private:
+    void grow();
+    void updateLowerCount() { lowerCount_ = Policy::lowerCount(sortedLen_, per_); }
+    ValType getValImpl(DefaultPercentile *) const;
+    template<typename P>
+    ValType getValImpl(P *) const {
+        if (lowerCount_ <= 0)
+            return nullVal_;
+        const ValType &lo = sorted_[lowerCount_ - 1];
+        return P::value(lo, lowerCount_ < sortedLen_ ? sorted_[lowerCount_] : lo, sortedLen_, per_);
+    }
+    void eraseSorted(const ValType &val);
+    void insertSorted(const ValType &val);
+
+    ValType nullVal_;
+    //circular queue in arrival order and the same non-null values in ascending order
+    std::vector<ValType> data_, sorted_;
+    int bufferSize_;
+    int curr_, prev_, count_, sortedLen_, lowerCount_;
+    bool med_;
+    double per_;
+};
+
+template<typename ValType, typename Policy>
+MovingPercentile<ValType, SortedBlock, Policy>::MovingPercentile(ValType nullVal, bool med, double per, int initBufSize)
+    : nullVal_(nullVal), data_(initBufSize), sorted_(initBufSize), bufferSize_(initBufSize),
+    curr_(0), prev_(0), count_(0), sortedLen_(0), lowerCount_(0), med_(med), per_(med ? 50.0 : per) {}
+
+template<typename ValType, typename Policy>
+ValType MovingPercentile<ValType, SortedBlock, Policy>::getValImpl(DefaultPercentile *) const {
+    if (lowerCount_ <= 0)
+        return nullVal_;
+    if (med_ && sortedLen_ % 2 == 0)
+        return (sorted_[lowerCount_ - 1] + sorted_[lowerCount_]) / 2.0;
+    return sorted_[lowerCount_ - 1];
+}
+
+template<typename ValType, typename Policy>
+void MovingPercentile<ValType, SortedBlock, Policy>::remove() {
+    if (count_ == 0)
+        return;
+    if (!(data_[prev_] == nullVal_))
+        eraseSorted(data_[prev_]);
+    if (++prev_ == bufferSize_)
+        prev_ = 0;
+    count_--;
+}
+
+template<typename ValType, typename Policy>
+void MovingPercentile<ValType, SortedBlock, Policy>::remove(int nums) {
+    if (nums >= count_) {
+        clear();
+        return;
+    }
+    for (int i = 0; i < nums; ++i)
+        remove();
+}
+
+template<typename ValType, typename Policy>
+void MovingPercentile<ValType, SortedBlock, Policy>::insert(ValType val) {
+    if (count_ == bufferSize_)
+        grow();
+    data_[curr_] = val;
+    if (!(val == nullVal_))
+        insertSorted(val);
+    if (++curr_ == bufferSize_)
+        curr_ = 0;
+    count_++;
+}
+
+template<typename ValType, typename Policy>
+void MovingPercentile<ValType, SortedBlock, Policy>::insert(const ValType *vals, int len) {
+    for (int i = 0; i < len; ++i)
+        insert(vals[i]);
+}
+
+template<typename ValType, typename Policy>
+void MovingPercentile<ValType, SortedBlock, Policy>::insertAndRemove(ValType val) {
+    if (count_ == 0)
+        return;
+    ValType old = data_[prev_];
+    if (old == nullVal_ || val == nullVal_) {
+        remove();
+        insert(val);
+        return;
+    }
+    //1.the new value takes over the slot of the oldest one in the circular queue
+    data_[curr_] = val;
+    if (++prev_ == bufferSize_)
+        prev_ = 0;
+    if (++curr_ == bufferSize_)
+        curr_ = 0;
+    //2.shift only the items between the evicted position and the insert position
+    sortedReplace(sorted_.data(), sortedLen_, old, val);
+}
+
+template<typename ValType, typename Policy>
+void MovingPercentile<ValType, SortedBlock, Policy>::insertAndRemove(const ValType *vals, int len) {
+    for (int i = 0; i < len; ++i)
+        insertAndRemove(vals[i]);
+}
+
+template<typename ValType, typename Policy>
+void MovingPercentile<ValType, SortedBlock, Policy>::grow() {
+    std::vector<ValType> data(bufferSize_ * 2);
+    for (int i = 0; i < count_; ++i)
+        data[i] = data_[(prev_ + i) % bufferSize_];
+    data_.swap(data);
+    sorted_.resize(bufferSize_ * 2);
+    prev_ = 0;
+    curr_ = count_;
+    bufferSize_ *= 2;
+}
+
+template<typename ValType, typename Policy>
+void MovingPercentile<ValType, SortedBlock, Policy>::eraseSorted(const ValType &val) {
+    ValType *first = sorted_.data();
+    int r = sortedLowerBound(first, sortedLen_, val);
+    std::copy(first + r + 1, first + sortedLen_, first + r);
+    sortedLen_--;
+    updateLowerCount();
+}
+
+template<typename ValType, typename Policy>
+void MovingPercentile<ValType, SortedBlock, Policy>::insertSorted(const ValType &val) {
+    ValType *first = sorted_.data();
+    int i = sortedUpperBound(first, sortedLen_, val);
+    std::copy_backward(first + i, first + sortedLen_, first + sortedLen_ + 1);
+    first[i] = val;
+    sortedLen_++;
+    updateLowerCount();
+}
@@ -0,0 +1,87 @@
+/*
+ *  TimeWindowPercentile.h
+ *
+ *  Created on : Oct 17, 2026
+ *  Time-based sliding window, e.g. p99 over the last 10 seconds
+ *  Entries older than the span are evicted automatically on insert
+ */
+
+#pragma once
+#include <vector>
+#include <utility>
+#include "MovingPercentile.h"
+
+template<typename ValType, typename TimeType = long long, typename Window = MovingPercentile<ValType>>
+class TimeWindowPercentile {
+public:
+    //span is kept here, args are forwarded to the underlying count-based window,
+    //e.g. TimeWindowPercentile<double>(10000, nullVal, med, per) builds MovingPercentile<double>(nullVal, med, per)
+    template<typename... Args>
+    explicit TimeWindowPercentile(TimeType span, Args&&... args)
+        : span_(span), window_(std::forward<Args>(args)...), ts_(16), head_(0), count_(0) {}
+    void clear() {
+        head_ = 0;
+        count_ = 0;
+        window_.clear();
+    }
+    template<typename... Args>
+    ValType getVal(Args... args) const { return window_.getVal(args...); }
+    //timestamps must be non-decreasing, an older one is treated as the latest seen
+    void insert(ValType val, TimeType ts);
+    void insert(const ValType *vals, const TimeType *ts, int len);
+    //evicts all entries with now - ts >= span in one batch
+    void expire(TimeType now);
+    int size() const { return count_; }
+    TimeType span() const { return span_; }
+    const Window &window() const { return window_; }
+private:
+    TimeType at(int i) const { return ts_[(head_ + i) & (ts_.size() - 1)]; }
+
+    TimeType span_;
+    Window window_;
+    //circular queue of timestamps, capacity is kept a power of two
+    std::vector<TimeType> ts_;
+    int head_, count_;
+};
+
+template<typename ValType, typename TimeType, typename Window>
+void TimeWindowPercentile<ValType, TimeType, Window>::insert(ValType val, TimeType ts) {
+    if (count_ > 0 && ts < at(count_ - 1))
+        ts = at(count_ - 1);
+    expire(ts);
+    if (count_ == static_cast<int>(ts_.size())) {
+        std::vector<TimeType> newTs(ts_.size() * 2);
+        for (int i = 0; i < count_; ++i)
+            newTs[i] = at(i);
+        ts_.swap(newTs);
+        head_ = 0;
+    }
+    ts_[(head_ + count_) & (ts_.size() - 1)] = ts;
+    count_++;
+    window_.insert(val);
+}
+
+template<typename ValType, typename TimeType, typename Window>
+void TimeWindowPercentile<ValType, TimeType, Window>::insert(const ValType *vals, const TimeType *ts, int len) {
+    for (int i = 0; i < len; ++i)
+        insert(vals[i], ts[i]);
+}
+
+template<typename ValType, typename TimeType, typename Window>
+void TimeWindowPercentile<ValType, TimeType, Window>::expire(TimeType now) {
+    //1.timestamps are sorted, binary search the first entry still alive
+    int lo = 0, hi = count_;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (now - at(mid) >= span_)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == 0)
+        return;
+    //2.evict all expired entries at once
+    window_.remove(lo);
+    head_ = (head_ + lo) & (ts_.size() - 1);
+    count_ -= lo;
+}
@@ -1,13 +1,46 @@
 #pragma once
 #include <vector>
 #include <utility>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <cassert>
+
+//define SDT_STATS before including to count points per compressor instance, read them with getStats()
+//without it the counters and getStats() do not exist and the hooks compile to nothing
+struct SDTStats {
+    //points passed to compress(), points dropped for a non-increasing x and points archived to the result or sink
+    unsigned long long pointsSeen, pointsDropped, pointsEmitted;
+    //times the door closed (kUp > kDown) and reopened on the previous point
+    unsigned long long doorResets;
+};
+#ifdef SDT_STATS
+#define SDT_STAT(expr) (stats.expr)
+#else
+#define SDT_STAT(expr) ((void)0)
+#endif
+#if defined(__GNUC__)
+#define SDT_HAS_VECTOR_EXT 1
+typedef double SDTx4 __attribute__((vector_size(32)));
+#endif
 
 using namespace std;
 class SDTCompressor {
 public:
+    //receives every archived point as soon as its door closes
+    typedef function<void(const pair<double, double> &)> Sink;
+
+    //archived points are kept in getResult()
     SDTCompressor(double precision)
-        : precision(precision), dblmin(numeric_limits<double>::lowest()), dblmax(numeric_limits<double>::max()), kUp(dblmin), kDown(dblmax) {
-        result.reserve(1000000);
+        : precision(precision), dblmax(numeric_limits<double>::max()), dblmin(numeric_limits<double>::lowest()), kUp(dblmin), kDown(dblmax) {
+    }
+    //archived points go to sink and are not kept, memory stays O(1) per compressor
+    //e.g. a ring buffer or an output iterator: SDTCompressor(0.5, [&](const pair<double, double> &p) { *out++ = p; })
+    SDTCompressor(double precision, Sink sink)
+        : SDTCompressor(precision) {
+        this->sink = std::move(sink);
     }
     void compress(const pair<double, double> &point) {
         compressImpl(point);
@@ -20,22 +53,85 @@ public:
         for (int i = 0; i < len; ++i)
             compressImpl(x[i], y[i]);
     }
-    vector<pair<double, double>> &getResult() {
-        if (result.rbegin()->first != doorPoint.first)
-            result.emplace_back(doorPoint);
+    //archive the last received point and restart the door on it, call at the end of a stream
+    void flush() {
+        if (started && prevPoint.first > lastEmitted) {
+            emit(prevPoint);
+            doorPoint = prevPoint;
+            kUp = dblmin;
+            kDown = dblmax;
+        }
+    }
+    //archived points so far, empty with a sink, flush() first to include the last received point
+    const vector<pair<double, double>> &getResult() const {
         return result;
     }
+    //value at x, linear between archived points, the last received point closes the line
+    //clamped to the first/last value outside them, NaN before any point
+    //decompression reads getResult(), so it needs the buffered constructor, a sink keeps no points to read
+    double decompress(double x) const {
+        assert(!sink && "decompress() needs buffered mode");
+        int n = pointCount();
+        if (n == 0)
+            return numeric_limits<double>::quiet_NaN();
+        if (x <= result[0].first)
+            return result[0].second;
+        const pair<double, double> &last = point(n - 1);
+        if (x >= last.first)
+            return last.second;
+        //first archived point after x, the virtual last point is after x here
+        int j = int(upper_bound(result.begin(), result.end(), x,
+            [](double v, const pair<double, double> &p) { return v < p.first; }) - result.begin());
+        const pair<double, double> &p0 = point(j - 1), &p1 = point(j);
+        double slope = (p1.second - p0.second) / (p1.first - p0.first);
+        return p0.second + (x - p0.first) * slope;
+    }
+    //values at ascending x[0..len) in one sweep over the archived points, O(points + len)
+    void decompress(const double *x, double *y, int len) const {
+        assert(!sink && "decompress() needs buffered mode");
+        int n = pointCount();
+        int i = 0;
+        if (n == 0) {
+            for (; i < len; ++i)
+                y[i] = numeric_limits<double>::quiet_NaN();
+            return;
+        }
+        for (; i < len && x[i] <= result[0].first; ++i)
+            y[i] = result[0].second;
+        for (int j = 1; j < n && i < len; ++j) {
+            const pair<double, double> &p0 = point(j - 1), &p1 = point(j);
+            int begin = i;
+            while (i < len && x[i] < p1.first)
+                ++i;
+            interpolate(x + begin, y + begin, i - begin, p0, p1);
+        }
+        for (; i < len; ++i)
+            y[i] = point(n - 1).second;
+    }
+    vector<double> decompress(const vector<double> &x) const {
+        vector<double> y(x.size());
+        decompress(x.data(), y.data(), int(x.size()));
+        return y;
+    }
+#ifdef SDT_STATS
+    const SDTStats &getStats() const { return stats; }
+    void resetStats() { stats = SDTStats(); }
+#endif
 
 private:
     void compressImpl(const pair<double, double> &curPoint) {
-        if (result.empty()) {
+        SDT_STAT(pointsSeen++);
+        if (!started) {
+            started = true;
             doorPoint = curPoint;
             prevPoint = curPoint;
-            result.push_back(curPoint);
+            emit(curPoint);
             return;
         }
-        if (curPoint.first <= doorPoint.first)
+        if (curPoint.first <= doorPoint.first) {
+            SDT_STAT(pointsDropped++);
             return;
+        }
         double curkUp = (curPoint.second - doorPoint.second - precision) / (curPoint.first - doorPoint.first);
         double curkDown = (curPoint.second - doorPoint.second + precision) / (curPoint.first - doorPoint.first);
         if (curkUp > kUp)
@@ -44,40 +140,50 @@ private:
             kDown = curkDown;
         if (kUp > kDown) {
             doorPoint = prevPoint;
-            result.emplace_back(prevPoint);
+            emit(prevPoint);
+            SDT_STAT(doorResets++);
             kUp = (curPoint.second - doorPoint.second - precision) / (curPoint.first - doorPoint.first);
             kDown = (curPoint.second - doorPoint.second + precision) / (curPoint.first - doorPoint.first);
         }
         prevPoint = curPoint;
     }
     void compressImpl(double x, double y) {
-        if (result.empty()) {
-            doorPoint = { x,y };
-            prevPoint = { x,y };
-            result.push_back({ x,y });
-            return;
-        }
-        if (x <= doorPoint.first)
-            return;
-        double curkUp = (y - doorPoint.second - precision) / (x - doorPoint.first);
-        double curkDown = (y - doorPoint.second + precision) / (x - doorPoint.first);
-        if (curkUp > kUp)
-            kUp = curkUp;
-        if (curkDown < kDown)
-            kDown = curkDown;
-        if (kUp <= kDown) {
-            return;
-        }
-        else {
-            doorPoint = prevPoint;
-            result.emplace_back(prevPoint);
-            kUp = (y - doorPoint.second - precision) / (x - doorPoint.first);
-            kDown = (y - doorPoint.second + precision) / (x - doorPoint.first);
-        }
-        prevPoint = { x,y };
+        compressImpl(make_pair(x, y));
+    }
+    void emit(const pair<double, double> &point) {
+        lastEmitted = point.first;
+        SDT_STAT(pointsEmitted++);
+        if (sink)
+            sink(point);
+        else
+            result.push_back(point);
     }
-    double decompressImpl(double x) {
-        //if(x < result.begin()->first || x > std::max())
+    //archived points plus the last received point when it is beyond them
+    int pointCount() const {
+        if (result.empty())
+            return 0;
+        return int(result.size()) + (prevPoint.first > result.back().first ? 1 : 0);
+    }
+    const pair<double, double> &point(int i) const {
+        return i < int(result.size()) ? result[i] : prevPoint;
+    }
+    //y = y0 + (x - x0) * slope over one segment, 4 lanes at a time
+    static void interpolate(const double *x, double *y, int len, const pair<double, double> &p0, const pair<double, double> &p1) {
+        double slope = (p1.second - p0.second) / (p1.first - p0.first);
+        int i = 0;
+#ifdef SDT_HAS_VECTOR_EXT
+        SDTx4 x0 = { p0.first, p0.first, p0.first, p0.first };
+        SDTx4 y0 = { p0.second, p0.second, p0.second, p0.second };
+        SDTx4 k = { slope, slope, slope, slope };
+        for (; i + 4 <= len; i += 4) {
+            SDTx4 v;
+            memcpy(&v, x + i, sizeof(v));
+            v = y0 + (v - x0) * k;
+            memcpy(y + i, &v, sizeof(v));
+        }
+#endif
+        for (; i < len; ++i)
+            y[i] = p0.second + (x[i] - p0.first) * slope;
     }
     double precision;
     double dblmax, dblmin;
@@ -85,4 +191,10 @@ private:
     double kUp, kDown;
     pair<double, double> doorPoint, prevPoint;
     vector<pair<double, double>> result;
+    Sink sink;
+    bool started = false;
+    double lastEmitted = 0;
+#ifdef SDT_STATS
+    SDTStats stats = SDTStats();
+#endif
 };